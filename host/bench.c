@@ -0,0 +1,101 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      bench.c
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "bench.h"
+
+#define BENCH_STACK_PAINT   0xA5
+
+typedef struct
+{
+    bench_fn_t  fn;
+    void*       arg;
+} bench_call_t;
+
+uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void* bench_thread(void* arg)
+{
+    bench_call_t* call = arg;
+
+    call->fn(call->arg);
+    return NULL;
+}
+
+size_t bench_stack_peak(bench_fn_t fn, void* arg, size_t stack_size)
+{
+    bench_call_t   call = { fn, arg };
+    pthread_attr_t attr;
+    pthread_t      thread;
+    uint8_t*       stack;
+    size_t         untouched = 0;
+
+    if(posix_memalign((void**)&stack, 4096, stack_size))
+        return 0;
+
+    memset(stack, BENCH_STACK_PAINT, stack_size);
+
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, stack, stack_size);
+    if(0==pthread_create(&thread, &attr, bench_thread, &call))
+    {
+        pthread_join(thread, NULL);
+
+        // The stack grows down, so the untouched paint is at the low end
+        while(untouched<stack_size && BENCH_STACK_PAINT==stack[untouched])
+            ++untouched;
+    }
+    else
+    {
+        fprintf(stderr, "bench_stack_peak: cannot create the thread!\n");
+        untouched = stack_size;
+    }
+    pthread_attr_destroy(&attr);
+    free(stack);
+
+    return stack_size - untouched;
+}
+
+uint8_t* bench_load_file(const char* path, size_t* sz)
+{
+    FILE*    f = fopen(path, "rb");
+    uint8_t* buff;
+    long     n;
+
+    if(!f)
+    {
+        perror(path);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    buff = malloc(n>0 ? n : 1);
+    if(!buff || n<0 || (size_t)n!=fread(buff, 1, n, f))
+    {
+        fprintf(stderr, "%s: cannot read\n", path);
+        fclose(f);
+        free(buff);
+        return NULL;
+    }
+    fclose(f);
+
+    *sz = (size_t)n;
+    return buff;
+}
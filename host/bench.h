@@ -0,0 +1,26 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      bench.h
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ */
+#include <stdint.h>
+#include <stddef.h>
+
+typedef void (*bench_fn_t)(void* arg);
+
+uint64_t bench_now_ns(void);
+
+/**
+ *  Runs fn(arg) on a freshly painted stack of stack_size bytes and returns how
+ *  many bytes of it were touched, the same high watermark idea FreeRTOS uses
+ *  for uxTaskGetStackHighWaterMark.
+ */
+size_t bench_stack_peak(bench_fn_t fn, void* arg, size_t stack_size);
+
+/**
+ *  Reads a whole file into a malloc'ed buffer, freed by the caller, and its
+ *  size into sz. Prints why and returns NULL when it cannot.
+ */
+uint8_t* bench_load_file(const char* path, size_t* sz);
@@ -0,0 +1,406 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      broker.c
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "broker.h"
+#include "bench.h"
+
+#define LEVELS_MAX      16
+#define TOPIC_LEN_MAX   128
+
+typedef struct
+{
+    unsigned        references;
+    size_t          len;
+    char*           data;
+    char            topic[];
+} message_t;
+
+typedef struct entry
+{
+    struct entry*   next;
+    message_t*      message;
+} entry_t;
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t  ready;
+    entry_t*        head;
+    entry_t*        tail;
+} queue_t;
+
+struct broker_client
+{
+    broker_client_t*     next;
+    broker_deliver_t     deliver;
+    broker_thread_init_t init;
+    void*                ctx;
+    queue_t              queue;
+    pthread_t            thread;
+};
+
+/**
+ *  Subscription tree, one node per topic level. Children are a plain list:
+ *  the fleet has one level with a child per device and that is the search
+ *  the broker pays per message.
+ */
+typedef struct node
+{
+    struct node*        next;
+    struct node*        children;
+    broker_client_t**   clients;
+    size_t              count;
+    size_t              size;
+    char                level[];
+} node_t;
+
+static pthread_mutex_t  g_lock = PTHREAD_MUTEX_INITIALIZER;
+static queue_t          g_inbound;
+static pthread_t        g_thread;
+static bool             g_running = false;
+static node_t*          g_root = NULL;
+static broker_client_t* g_clients = NULL;
+static broker_stats_t   g_stats;
+
+static void message_release(message_t* message)
+{
+    if(0==__atomic_sub_fetch(&message->references, 1, __ATOMIC_ACQ_REL))
+        free(message);
+}
+
+static void queue_init(queue_t* q)
+{
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->ready, NULL);
+    q->head = q->tail = NULL;
+}
+
+static void queue_push(queue_t* q, message_t* message)
+{
+    entry_t* e = malloc(sizeof(entry_t));
+
+    e->next = NULL;
+    e->message = message;
+
+    pthread_mutex_lock(&q->lock);
+    if(q->tail)
+        q->tail->next = e;
+    else
+        q->head = e;
+    q->tail = e;
+    pthread_cond_signal(&q->ready);
+    pthread_mutex_unlock(&q->lock);
+}
+
+/**
+ *  Blocks until there is a message, NULL once the broker stops.
+ */
+static message_t* queue_pop(queue_t* q)
+{
+    message_t* message = NULL;
+
+    pthread_mutex_lock(&q->lock);
+    while(!q->head && __atomic_load_n(&g_running, __ATOMIC_ACQUIRE))
+        pthread_cond_wait(&q->ready, &q->lock);
+
+    if(q->head && __atomic_load_n(&g_running, __ATOMIC_ACQUIRE))
+    {
+        entry_t* e = q->head;
+
+        q->head = e->next;
+        if(!q->head)
+            q->tail = NULL;
+        message = e->message;
+        free(e);
+    }
+    pthread_mutex_unlock(&q->lock);
+
+    return message;
+}
+
+static void queue_wake(queue_t* q)
+{
+    pthread_mutex_lock(&q->lock);
+    pthread_cond_broadcast(&q->ready);
+    pthread_mutex_unlock(&q->lock);
+}
+
+static void queue_drain(queue_t* q)
+{
+    while(q->head)
+    {
+        entry_t* e = q->head;
+
+        q->head = e->next;
+        message_release(e->message);
+        free(e);
+    }
+    q->tail = NULL;
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->ready);
+}
+
+static size_t split(char* topic, char** levels)
+{
+    size_t n = 0;
+    char*  p = topic;
+
+    levels[n++] = p;
+    for(; *p && n<LEVELS_MAX; ++p)
+    {
+        if('/'==*p)
+        {
+            *p = 0;
+            levels[n++] = p+1;
+        }
+    }
+    return n;
+}
+
+static node_t* child(node_t* parent, const char* level, bool create)
+{
+    node_t* n;
+
+    for(n=parent->children; n; n=n->next)
+    {
+        if(0==strcmp(n->level, level))
+            return n;
+    }
+
+    if(!create)
+        return NULL;
+
+    n = calloc(1, sizeof(node_t) + strlen(level) + 1);
+    strcpy(n->level, level);
+    n->next = parent->children;
+    parent->children = n;
+    return n;
+}
+
+static void node_free(node_t* node)
+{
+    while(node)
+    {
+        node_t* next = node->next;
+
+        node_free(node->children);
+        free(node->clients);
+        free(node);
+        node = next;
+    }
+}
+
+static void deliver(const node_t* node, message_t* message)
+{
+    size_t k;
+
+    for(k=0; k<node->count; ++k)
+    {
+        __atomic_add_fetch(&message->references, 1, __ATOMIC_RELAXED);
+        queue_push(&node->clients[k]->queue, message);
+        __atomic_add_fetch(&g_stats.delivered, 1, __ATOMIC_RELAXED);
+    }
+}
+
+static void match(const node_t* node, char** levels, size_t count, message_t* message)
+{
+    const node_t* n;
+
+    for(n=node->children; n; n=n->next)
+    {
+        if(0==strcmp(n->level, "#"))
+        {
+            deliver(n, message);
+        }
+        else if(0==strcmp(n->level, "+") || 0==strcmp(n->level, levels[0]))
+        {
+            if(1==count)
+            {
+                const node_t* all = child((node_t*)n, "#", false);
+
+                deliver(n, message);
+                if(all)
+                    deliver(all, message);     // "a/#" also matches "a"
+            }
+            else
+            {
+                match(n, levels+1, count-1, message);
+            }
+        }
+    }
+}
+
+static void* broker_thread(void* arg)
+{
+    message_t* message;
+
+    while(NULL!=(message = queue_pop(&g_inbound)))
+    {
+        char     topic[TOPIC_LEN_MAX];
+        char*    levels[LEVELS_MAX];
+        size_t   count;
+        uint64_t t0 = bench_now_ns();
+
+        snprintf(topic, sizeof(topic), "%s", message->topic);
+        count = split(topic, levels);
+
+        pthread_mutex_lock(&g_lock);
+        match(g_root, levels, count, message);
+        pthread_mutex_unlock(&g_lock);
+        __atomic_add_fetch(&g_stats.busy_ns, bench_now_ns() - t0, __ATOMIC_RELAXED);
+
+        message_release(message);
+    }
+    return NULL;
+}
+
+static void* client_thread(void* arg)
+{
+    broker_client_t* client = arg;
+    message_t*       message;
+
+    if(client->init)
+        client->init(client->ctx);
+
+    while(NULL!=(message = queue_pop(&client->queue)))
+    {
+        client->deliver(client->ctx, message->topic, message->data, message->len);
+        message_release(message);
+    }
+    return NULL;
+}
+
+void broker_start(void)
+{
+    memset(&g_stats, 0, sizeof(g_stats));
+    queue_init(&g_inbound);
+    g_root = calloc(1, sizeof(node_t) + 1);
+    __atomic_store_n(&g_running, true, __ATOMIC_RELEASE);
+    pthread_create(&g_thread, NULL, broker_thread, NULL);
+}
+
+/**
+ *  Stops the broker and the delivery threads, after the callbacks in progress
+ *  return; pending messages are discarded. Anything publishing from outside
+ *  the delivery threads must be stopped first.
+ */
+void broker_stop(void)
+{
+    broker_client_t* client;
+
+    __atomic_store_n(&g_running, false, __ATOMIC_RELEASE);
+
+    queue_wake(&g_inbound);
+    pthread_join(g_thread, NULL);
+
+    for(client=g_clients; client; client=client->next)
+    {
+        queue_wake(&client->queue);
+        pthread_join(client->thread, NULL);
+    }
+
+    while(g_clients)
+    {
+        client = g_clients;
+        g_clients = client->next;
+        queue_drain(&client->queue);
+        free(client);
+    }
+    queue_drain(&g_inbound);
+
+    node_free(g_root);
+    g_root = NULL;
+}
+
+broker_client_t* broker_connect(broker_deliver_t deliver, broker_thread_init_t init, void* ctx)
+{
+    broker_client_t* client = calloc(1, sizeof(broker_client_t));
+    pthread_attr_t   attr;
+
+    client->deliver = deliver;
+    client->init = init;
+    client->ctx = ctx;
+    queue_init(&client->queue);
+
+    pthread_mutex_lock(&g_lock);
+    client->next = g_clients;
+    g_clients = client;
+    pthread_mutex_unlock(&g_lock);
+
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, 256*1024);
+    pthread_create(&client->thread, &attr, client_thread, client);
+    pthread_attr_destroy(&attr);
+
+    return client;
+}
+
+void broker_subscribe(broker_client_t* client, const char* filter)
+{
+    char    topic[TOPIC_LEN_MAX];
+    char*   levels[LEVELS_MAX];
+    size_t  count, k;
+    node_t* node;
+
+    snprintf(topic, sizeof(topic), "%s", filter);
+    count = split(topic, levels);
+
+    pthread_mutex_lock(&g_lock);
+    node = g_root;
+    for(k=0; k<count; ++k)
+        node = child(node, levels[k], true);
+
+    for(k=0; k<node->count && node->clients[k]!=client; ++k)
+        ;
+    if(k==node->count)
+    {
+        if(node->count==node->size)
+        {
+            node->size = node->size ? 2*node->size : 4;
+            node->clients = realloc(node->clients, node->size*sizeof(broker_client_t*));
+        }
+        node->clients[node->count++] = client;
+    }
+    pthread_mutex_unlock(&g_lock);
+}
+
+void broker_publish(const char* topic, const char* data, size_t len)
+{
+    size_t     topic_len = strlen(topic);
+    message_t* message;
+
+    if(topic_len>=TOPIC_LEN_MAX)
+        return;
+
+    if(!__atomic_load_n(&g_running, __ATOMIC_ACQUIRE))
+        return;
+
+    message = malloc(sizeof(message_t) + topic_len + 1 + len + 1);
+    message->references = 1;
+    message->len = len;
+    memcpy(message->topic, topic, topic_len+1);
+    message->data = message->topic + topic_len + 1;
+    memcpy(message->data, data, len);
+    message->data[len] = 0;
+
+    __atomic_add_fetch(&g_stats.published, 1, __ATOMIC_RELAXED);
+    queue_push(&g_inbound, message);
+}
+
+void broker_read_stats(broker_stats_t* stats)
+{
+    stats->published = __atomic_load_n(&g_stats.published, __ATOMIC_RELAXED);
+    stats->delivered = __atomic_load_n(&g_stats.delivered, __ATOMIC_RELAXED);
+    stats->busy_ns = __atomic_load_n(&g_stats.busy_ns, __ATOMIC_RELAXED);
+}
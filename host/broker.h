@@ -0,0 +1,42 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      broker.h
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ */
+#ifndef BROKER_H
+#define BROKER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ *  In-process stand-in for the MQTT broker, QoS 0 only. Publishing queues the
+ *  message for the broker thread, which matches it against the subscription
+ *  tree (+ and # wildcards) and queues it for every subscribed client. Each
+ *  client has its own delivery thread, like the MQTT task of a device.
+ *
+ *  Queues are unbounded: nothing is dropped, an overloaded broker shows up as
+ *  latency.
+ */
+typedef struct broker_client broker_client_t;
+
+typedef void (*broker_deliver_t)(void* ctx, const char* topic, const char* data, size_t len);
+typedef void (*broker_thread_init_t)(void* ctx);
+
+typedef struct
+{
+    uint64_t    published;      // messages in
+    uint64_t    delivered;      // messages out, one per matching client
+    uint64_t    busy_ns;        // broker thread time spent routing
+} broker_stats_t;
+
+void             broker_start(void);
+void             broker_stop(void);
+broker_client_t* broker_connect(broker_deliver_t deliver, broker_thread_init_t init, void* ctx);
+void             broker_subscribe(broker_client_t* client, const char* filter);
+void             broker_publish(const char* topic, const char* data, size_t len);
+void             broker_read_stats(broker_stats_t* stats);
+
+#endif
@@ -0,0 +1,155 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      derived_bench.c
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ *
+ *  Accuracy and cost of the integer dew point and heat index against a float
+ *  reference, over the whole DHT22 range (-40..80 celsius degrees, 0..100 %).
+ *
+ *  usage: derived_bench [iterations]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "derived.h"
+#include "bench.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+typedef int16_t (*derived_fn_t)(int16_t temperature, uint16_t humidity);
+
+typedef struct
+{
+    double  max;
+    double  sum;
+    int16_t max_temperature;
+    int16_t max_humidity;
+    long    n;
+} accuracy_t;
+
+static volatile int32_t g_sink;
+
+static double dew_point_ref(double t, double rh)
+{
+    double g;
+
+    if(rh<0.1)
+        rh = 0.1;
+    g = log(rh/100.0) + 17.62*t/(243.12+t);
+    return 243.12*g/(17.62-g);
+}
+
+static double heat_index_ref(double t, double rh)
+{
+    double f, hi;
+
+    if(t>50.0)
+        t = 50.0;
+
+    f = t*1.8 + 32.0;
+    hi = 0.5*(f + 61.0 + (f-68.0)*1.2 + rh*0.094);
+    if((hi+f)/2.0>=80.0)
+    {
+        hi = -42.379 + 2.04901523*f + 10.14333127*rh - 0.22475541*f*rh - 0.00683783*f*f
+           - 0.05481717*rh*rh + 0.00122874*f*f*rh + 0.00085282*f*rh*rh - 0.00000199*f*f*rh*rh;
+        if(rh<13.0 && f>=80.0 && f<=112.0)
+            hi -= ((13.0-rh)/4.0)*sqrt((17.0-fabs(f-95.0))/17.0);
+        if(rh>85.0 && f>=80.0 && f<=87.0)
+            hi += ((rh-85.0)/10.0)*((87.0-f)/5.0);
+    }
+    return (hi-32.0)/1.8;
+}
+
+static void accuracy(derived_fn_t fn, double (*ref)(double, double), accuracy_t* e)
+{
+    int16_t  t;
+    uint16_t h;
+
+    e->max = e->sum = 0;
+    e->n = 0;
+    for(t=-400; t<=800; ++t)
+    {
+        for(h=0; h<=1000; ++h)
+        {
+            double d = fabs(fn(t, h)/10.0 - ref(t/10.0, h/10.0));
+
+            if(d>e->max)
+            {
+                e->max = d;
+                e->max_temperature = t;
+                e->max_humidity = h;
+            }
+            e->sum += d;
+            ++e->n;
+        }
+    }
+}
+
+static int16_t dew_point_float(int16_t t, uint16_t h)
+{
+    return (int16_t)lround(10.0*dew_point_ref(t/10.0, h/10.0));
+}
+
+static int16_t heat_index_float(int16_t t, uint16_t h)
+{
+    return (int16_t)lround(10.0*heat_index_ref(t/10.0, h/10.0));
+}
+
+static void timing(const char* name, derived_fn_t fn, unsigned iterations)
+{
+    uint64_t t0, ns;
+    int32_t  sum = 0;
+    unsigned k;
+#if defined(HAVE_TSC)
+    uint64_t c0, cycles;
+#endif
+
+    t0 = bench_now_ns();
+#if defined(HAVE_TSC)
+    c0 = __rdtsc();
+#endif
+    for(k=0; k<iterations; ++k)
+    {
+        // Walk the domain with co-prime strides so nothing is loop invariant
+        sum += fn((int16_t)((k*37)%1201) - 400, (uint16_t)((k*101)%1001));
+    }
+#if defined(HAVE_TSC)
+    cycles = __rdtsc() - c0;
+#endif
+    ns = bench_now_ns() - t0;
+    g_sink = sum;
+
+#if defined(HAVE_TSC)
+    printf("%-18s: %6.1f ns/call  %6.1f TSC cycles/call\n", name, (double)ns/iterations, (double)cycles/iterations);
+#else
+    printf("%-18s: %6.1f ns/call\n", name, (double)ns/iterations);
+#endif
+}
+
+int main(int argc, char** argv)
+{
+    unsigned iterations = (argc>1) ? (unsigned)strtoul(argv[1], NULL, 0) : 10000000;
+    accuracy_t e;
+
+    accuracy(derived_dew_point, dew_point_ref, &e);
+    printf("dew point  error  : max %.3f (t=%d rh=%d) mean %.4f celsius degrees\n",
+           e.max, e.max_temperature, e.max_humidity, e.sum/e.n);
+
+    accuracy(derived_heat_index, heat_index_ref, &e);
+    printf("heat index error  : max %.3f (t=%d rh=%d) mean %.4f celsius degrees\n",
+           e.max, e.max_temperature, e.max_humidity, e.sum/e.n);
+
+    timing("dew point int", derived_dew_point, iterations);
+    timing("dew point float", dew_point_float, iterations);
+    timing("heat index int", derived_heat_index, iterations);
+    timing("heat index float", heat_index_float, iterations);
+
+    return 0;
+}
@@ -0,0 +1,480 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      device.c
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ *
+ *  What the firmware calls outside main/ when it runs as a virtual device:
+ *  FreeRTOS tasks and delays, wifi and event loop, gpio, the DHT22 driver and
+ *  the MQTT client. Time runs speed times faster than the wall clock.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <sys/mman.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_system.h"
+#include "esp_wifi.h"
+#include "esp_event_loop.h"
+#include "nvs_flash.h"
+#include "driver/gpio.h"
+#include "mqtt.h"
+
+#include "dht22.h"
+#include "device.h"
+#include "broker.h"
+#include "bench.h"
+
+#define DEVICE_STACK_SZ     (256*1024)
+
+typedef struct
+{
+    device_t*       device;
+    TaskFunction_t  fn;
+    void*           arg;
+} task_t;
+
+static __thread device_t* g_device = NULL;
+
+static uint8_t*         g_image = NULL;
+static size_t           g_image_sz = 0;
+static uint64_t         g_start_ns = 0;
+static unsigned         g_speed = 1;
+static device_sensor_t  g_sensor = device_sensor_swing;
+static bool             g_verbose = false;
+
+static pthread_mutex_t  g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   g_wake;
+static bool             g_stopping = false;
+
+/**
+ *  Reads the firmware image once; device_start loads a private copy of it.
+ */
+bool device_load(const char* path)
+{
+    pthread_condattr_t attr;
+
+    g_image = bench_load_file(path, &g_image_sz);
+    if(!g_image)
+        return false;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&g_wake, &attr);
+    pthread_condattr_destroy(&attr);
+    return true;
+}
+
+void device_unload(void)
+{
+    free(g_image);
+    g_image = NULL;
+}
+
+void device_clock_start(unsigned speed)
+{
+    g_start_ns = bench_now_ns();
+    g_speed = speed ? speed : 1;
+
+    pthread_mutex_lock(&g_lock);
+    g_stopping = false;
+    pthread_mutex_unlock(&g_lock);
+}
+
+void device_set_sensor(device_sensor_t sensor)
+{
+    g_sensor = sensor;
+}
+
+void device_set_verbose(bool verbose)
+{
+    g_verbose = verbose;
+}
+
+/**
+ *  Device time, in ms.
+ */
+static uint32_t now_ms(void)
+{
+    return (uint32_t)((bench_now_ns() - g_start_ns)*g_speed/1000000);
+}
+
+static void* task_thread(void* arg)
+{
+    task_t task = *(task_t*)arg;
+
+    free(arg);
+    g_device = task.device;
+    task.fn(task.arg);
+    return NULL;
+}
+
+static bool spawn(device_t* device, TaskFunction_t fn, void* arg)
+{
+    task_t*        task;
+    pthread_attr_t attr;
+    unsigned       slot;
+    int            error;
+
+    // app_main starts its own tasks while device_start may still be here
+    pthread_mutex_lock(&g_lock);
+    slot = device->tasks_count;
+    if(slot<DEVICE_TASKS_MAX)
+        ++device->tasks_count;
+    pthread_mutex_unlock(&g_lock);
+
+    if(slot==DEVICE_TASKS_MAX)
+        return false;
+
+    task = malloc(sizeof(task_t));
+    task->device = device;
+    task->fn = fn;
+    task->arg = arg;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, DEVICE_STACK_SZ);
+    error = pthread_create(&device->tasks[slot], &attr, task_thread, task);
+    pthread_attr_destroy(&attr);
+
+    if(error)
+    {   // Leaves a hole, the device is not going to work anyway
+        free(task);
+        device->tasks[slot] = pthread_self();
+        return false;
+    }
+    return true;
+}
+
+/**
+ *  Loads a private copy of the firmware image: dlopen maps a file only once,
+ *  so each device gets its own memfd, hence its own globals. The memfd stays
+ *  open while the device lives, dlopen also tells files apart by name.
+ */
+bool device_start(device_t* device, unsigned id)
+{
+    char  path[32];
+    int   fd = memfd_create("thermostat", 0);
+    void  (*app_main)(void);
+
+    memset(device, 0, sizeof(*device));
+    device->fd = fd;
+    device->id = id;
+    device->seed = 0x9E3779B9u*(id+1);
+    device->prefix_len = snprintf(device->prefix, sizeof(device->prefix), "fleet/%u", id);
+
+    if(fd<0 || (ssize_t)g_image_sz!=write(fd, g_image, g_image_sz))
+    {
+        perror("memfd");
+        return false;
+    }
+
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+    device->image = dlopen(path, RTLD_NOW|RTLD_LOCAL);
+    if(!device->image)
+    {
+        fprintf(stderr, "%s\n", dlerror());
+        return false;
+    }
+
+    *(void**)&app_main = dlsym(device->image, "app_main");
+    if(!app_main)
+    {
+        fprintf(stderr, "%s\n", dlerror());
+        return false;
+    }
+
+    return spawn(device, (TaskFunction_t)app_main, NULL);
+}
+
+/**
+ *  Ends every task at its next vTaskDelay. The MQTT delivery threads belong
+ *  to the broker, stop it next and only then release the devices.
+ */
+void device_stop(device_t* devices, unsigned count)
+{
+    unsigned i, k;
+
+    pthread_mutex_lock(&g_lock);
+    g_stopping = true;
+    pthread_cond_broadcast(&g_wake);
+    pthread_mutex_unlock(&g_lock);
+
+    for(i=0; i<count; ++i)
+    {
+        for(k=0; k<devices[i].tasks_count; ++k)
+            pthread_join(devices[i].tasks[k], NULL);
+        devices[i].tasks_count = 0;
+    }
+}
+
+void device_release(device_t* devices, unsigned count)
+{
+    unsigned i;
+
+    for(i=0; i<count; ++i)
+    {
+        if(devices[i].image)
+            dlclose(devices[i].image);
+        if(devices[i].fd>=0)
+            close(devices[i].fd);
+        devices[i].image = NULL;
+        devices[i].fd = -1;
+    }
+}
+
+int device_printf(const char* format, ...)
+{
+    va_list args;
+    int     n;
+
+    if(!g_verbose)
+        return 0;
+
+    va_start(args, format);
+    printf("[%u] ", g_device ? g_device->id : 0);
+    n = vprintf(format, args);
+    va_end(args);
+    return n;
+}
+
+/*
+ *  FreeRTOS
+ */
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t depth, void* arg, UBaseType_t priority, TaskHandle_t* handle)
+{
+    return spawn(g_device, fn, arg) ? pdPASS : pdFALSE;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    uint64_t        deadline = bench_now_ns() + (uint64_t)ticks*portTICK_PERIOD_MS*1000000/g_speed;
+    struct timespec ts = { (time_t)(deadline/1000000000), (long)(deadline%1000000000) };
+
+    pthread_mutex_lock(&g_lock);
+    while(!g_stopping && bench_now_ns()<deadline)
+    {
+        pthread_cond_timedwait(&g_wake, &g_lock, &ts);
+    }
+    if(g_stopping)
+    {
+        pthread_mutex_unlock(&g_lock);
+        pthread_exit(NULL);
+    }
+    pthread_mutex_unlock(&g_lock);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return now_ms()/portTICK_PERIOD_MS;
+}
+
+TickType_t xTaskGetTickCountFromISR(void)
+{
+    return xTaskGetTickCount();
+}
+
+/*
+ *  System, wifi and event loop: the station connects as soon as it starts.
+ */
+uint32_t system_get_free_heap_size(void)
+{
+    return 0;
+}
+
+const char* system_get_sdk_version(void)
+{
+    return "host";
+}
+
+esp_err_t nvs_flash_init(void)
+{
+    return ESP_OK;
+}
+
+void tcpip_adapter_init(void)
+{
+}
+
+esp_err_t esp_event_loop_init(system_event_cb_t cb, void* ctx)
+{
+    g_device->event_cb = (void*)cb;
+    g_device->event_ctx = ctx;
+    return ESP_OK;
+}
+
+static void post_event(system_event_id_t id)
+{
+    system_event_t event = { id };
+
+    if(g_device->event_cb)
+        ((system_event_cb_t)g_device->event_cb)(g_device->event_ctx, &event);
+}
+
+esp_err_t esp_wifi_init(const wifi_init_config_t* config)                  { return ESP_OK; }
+esp_err_t esp_wifi_set_storage(wifi_storage_t storage)                     { return ESP_OK; }
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode)                              { return ESP_OK; }
+esp_err_t esp_wifi_set_config(esp_interface_t interface, wifi_config_t* c) { return ESP_OK; }
+
+esp_err_t esp_wifi_start(void)
+{
+    post_event(SYSTEM_EVENT_STA_START);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_connect(void)
+{
+    post_event(SYSTEM_EVENT_STA_GOT_IP);
+    return ESP_OK;
+}
+
+/*
+ *  gpio, only the relays are outputs
+ */
+esp_err_t gpio_config(const gpio_config_t* config)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(int pin, uint32_t level)
+{
+    if(pin<0 || pin>=(int)sizeof(g_device->relays))
+        return ESP_FAIL;
+
+    if(g_device->relays[pin]!=(level ? 1 : 0))
+        __atomic_add_fetch(&g_device->relay_switches, 1, __ATOMIC_RELAXED);
+    g_device->relays[pin] = level ? 1 : 0;
+    return ESP_OK;
+}
+
+/*
+ *  DHT22, scripted readings
+ */
+void dht22_init(void)
+{
+}
+
+bool dht22_read(uint16_t* humidity, int16_t* temperature)
+{
+    device_t* d = g_device;
+    double    period = 60000.0*(1 + d->id%5);
+    double    phase = 2*M_PI*(now_ms() + 7919.0*d->id)/period;
+    double    t, h;
+
+    d->seed = d->seed*1664525u + 1013904223u;
+
+    if(device_sensor_flaky==g_sensor && (d->seed>>8)%10==0)
+        return false;
+
+    if(device_sensor_steady==g_sensor)
+    {
+        t = 250 + (int)((d->seed>>8)%5) - 2;
+        h = 450;
+    }
+    else
+    {
+        t = 250 + 20*sin(phase);
+        h = 450 + 100*cos(phase);
+    }
+
+    if(humidity) *humidity = (uint16_t)h;
+    if(temperature) *temperature = (int16_t)t;
+    return true;
+}
+
+bool dht22_read_timing(dht22_timing_t* timing)
+{
+    return false;
+}
+
+size_t dht22_capture_peek(uint8_t* buff)
+{
+    return 0;
+}
+
+void dht22_capture_drop(void)
+{
+}
+
+/*
+ *  MQTT client, on the broker stand-in under the fleet/<id> prefix
+ */
+static void client_init(void* ctx)
+{
+    g_device = ctx;
+}
+
+static void client_deliver(void* ctx, const char* topic, const char* data, size_t len)
+{
+    device_t*         d = ctx;
+    mqtt_settings*    settings = d->settings;
+    mqtt_event_data_t event = { 0 };
+
+    if(strncmp(topic, d->prefix, d->prefix_len))
+        return;
+
+    event.topic = topic + d->prefix_len;
+    event.topic_length = (uint16_t)strlen(event.topic);
+    event.data = data;
+    event.data_length = (uint16_t)len;
+    event.data_total_length = (uint16_t)len;
+
+    settings->data_cb((mqtt_client*)d, &event);
+}
+
+static const char* full_topic(char* buff, size_t sz, const device_t* d, const char* topic)
+{
+    snprintf(buff, sz, "%s%s", d->prefix, topic);
+    return buff;
+}
+
+void mqtt_start(mqtt_settings* settings)
+{
+    mqtt_event_data_t event = { 0 };
+
+    g_device->settings = settings;
+    g_device->client = broker_connect(client_deliver, client_init, g_device);
+
+    if(settings->connected_cb)
+        settings->connected_cb((mqtt_client*)g_device, &event);
+}
+
+void mqtt_stop(void)
+{
+}
+
+void mqtt_subscribe(mqtt_client* client, const char* topic, uint8_t qos)
+{
+    device_t*         d = (device_t*)client;
+    mqtt_settings*    settings = d->settings;
+    mqtt_event_data_t event = { 0 };
+    char              s[128];
+
+    broker_subscribe(d->client, full_topic(s, sizeof(s), d, topic));
+
+    if(settings->subscribe_cb)
+        settings->subscribe_cb(client, &event);
+}
+
+void mqtt_publish(mqtt_client* client, const char* topic, const char* data, int len, int qos, int retain)
+{
+    device_t*         d = (device_t*)client;
+    mqtt_settings*    settings = d->settings;
+    mqtt_event_data_t event = { 0 };
+    char              s[128];
+
+    broker_publish(full_topic(s, sizeof(s), d, topic), data, len);
+    __atomic_add_fetch(&d->published, 1, __ATOMIC_RELAXED);
+
+    if(settings->publish_cb)
+        settings->publish_cb(client, &event);
+}
@@ -0,0 +1,70 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      device.h
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ */
+#ifndef DEVICE_H
+#define DEVICE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "broker.h"
+
+/**
+ *  A virtual thermostat: a private copy of the firmware (libthermostat.so,
+ *  main.c and comm.c built against the shim/ headers) loaded with its own
+ *  globals, whose tasks run as threads. The FreeRTOS, wifi, gpio, DHT22 and
+ *  MQTT client calls of the firmware land in device.c, which finds the
+ *  calling device through a thread local pointer.
+ *
+ *  Device n sees the broker through a fleet/<n> prefix, so every copy keeps
+ *  the same CONFIG_MQTT_TOPIC_DEFAULT.
+ */
+#define DEVICE_TASKS_MAX    4
+
+typedef enum
+{
+    device_sensor_steady        // around the default setpoint, little noise
+,   device_sensor_swing         // slow swings across the setpoint, the relay switches
+,   device_sensor_flaky         // swing with 10% failed reads
+} device_sensor_t;
+
+typedef struct
+{
+    unsigned            id;
+    void*               image;
+    int                 fd;
+    char                prefix[24];
+    size_t              prefix_len;
+
+    pthread_t           tasks[DEVICE_TASKS_MAX];
+    unsigned            tasks_count;
+
+    void*               settings;       // mqtt_settings of the firmware
+    broker_client_t*    client;
+    void*               event_cb;       // system_event_cb_t
+    void*               event_ctx;
+
+    uint32_t            seed;
+    uint64_t            published;
+    uint64_t            relay_switches;
+    uint8_t             relays[64];
+} device_t;
+
+bool device_load(const char* path);
+void device_unload(void);
+
+void device_clock_start(unsigned speed);
+void device_set_sensor(device_sensor_t sensor);
+void device_set_verbose(bool verbose);
+
+bool device_start(device_t* device, unsigned id);
+void device_stop(device_t* devices, unsigned count);
+void device_release(device_t* devices, unsigned count);
+
+#endif
@@ -0,0 +1,132 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      dht22_decode_bench.c
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ *
+ *  Decode success rate of the calibrated decoder against the former fixed
+ *  window one, over synthetic frames with skew, jitter and off-nominal timing.
+ *
+ *  usage: dht22_decode_bench [frames per scenario]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "dht22_decode.h"
+#include "waveform.h"
+#include "bench.h"
+
+/**
+ *  What read() did before: fixed windows on the odd edges, from index 3.
+ */
+static dht22_decode_result_t legacy_decode(const dht22_edge_t* edges, size_t count, uint8_t raw[5])
+{
+    size_t index;
+
+    memset(raw, 0, 5);
+    for(index=3; index<count; index+=2)
+    {
+        uint32_t delta = edges[index].time - edges[index-1].time;
+        uint8_t* p = raw + (index-3)/2/8;
+
+        if((index-3)/2>=DHT22_BITS)
+            break;
+
+        *p <<= 1;
+        if(delta>150 && delta<=400)
+        {
+        }
+        else if(delta>400 && delta<900)
+        {
+            *p |= 1;
+        }
+        else
+        {
+            return dht22_decode_timing;
+        }
+    }
+
+    if(count<83)
+        return dht22_decode_short;
+
+    if(raw[4]!=(uint8_t)(raw[0] + raw[1] + raw[2] + raw[3]))
+        return dht22_decode_checksum;
+
+    return dht22_decode_ok;
+}
+
+typedef struct
+{
+    unsigned    ok;
+    unsigned    wrong;          // accepted but not what was sent
+    uint64_t    margin;
+    uint16_t    margin_min;
+} score_t;
+
+static void score(score_t* s, dht22_decode_result_t result, const uint8_t sent[5], const uint8_t got[5])
+{
+    if(dht22_decode_ok==result)
+    {
+        if(memcmp(sent, got, 5))
+            ++s->wrong;
+        else
+            ++s->ok;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    unsigned frames = (argc>1) ? (unsigned)strtoul(argv[1], NULL, 0) : 20000;
+    unsigned k, i;
+    uint64_t t0, t_decode = 0, t_legacy = 0;
+
+    printf("%-18s %9s %9s %9s %9s %12s\n", "scenario", "legacy %", "wrong", "new %", "wrong", "margin us");
+    for(i=0; i<WAVEFORM_SCENARIOS; ++i)
+    {
+        score_t  legacy = { 0 }, calibrated = { 0 };
+        uint32_t seed = 0x1234567u + i;
+
+        calibrated.margin_min = UINT16_MAX;
+        for(k=0; k<frames; ++k)
+        {
+            dht22_edge_t   edges[DHT22_EDGES_MAX];
+            dht22_timing_t timing;
+            uint8_t        sent[5], got[5];
+            size_t         count;
+            dht22_decode_result_t result;
+
+            waveform_raw(sent, &seed);
+            count = waveform_frame(&g_waveform_scenarios[i], sent, edges, &seed);
+
+            t0 = bench_now_ns();
+            result = legacy_decode(edges, count, got);
+            t_legacy += bench_now_ns() - t0;
+            score(&legacy, result, sent, got);
+
+            t0 = bench_now_ns();
+            result = dht22_decode(edges, count, got, &timing);
+            t_decode += bench_now_ns() - t0;
+            score(&calibrated, result, sent, got);
+            if(dht22_decode_ok==result)
+            {
+                calibrated.margin += timing.margin;
+                if(timing.margin<calibrated.margin_min)
+                    calibrated.margin_min = timing.margin;
+            }
+        }
+
+        printf("%-18s %9.2f %9u %9.2f %9u %5.1f/%5.1f\n", g_waveform_scenarios[i].name,
+               100.0*legacy.ok/frames, legacy.wrong,
+               100.0*calibrated.ok/frames, calibrated.wrong,
+               calibrated.ok ? (double)calibrated.margin/calibrated.ok/DHT22_TICKS_PER_US : 0.0,
+               calibrated.ok ? (double)calibrated.margin_min/DHT22_TICKS_PER_US : 0.0);
+    }
+    printf("(margin is mean/min distance of the worst bit to the threshold)\n");
+    printf("decode time: legacy %.1f ns/frame, calibrated %.1f ns/frame\n",
+           (double)t_legacy/(frames*WAVEFORM_SCENARIOS), (double)t_decode/(frames*WAVEFORM_SCENARIOS));
+
+    return 0;
+}
@@ -0,0 +1,241 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      dht22_replay.c
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ *
+ *  Replays DHT22 edge captures (see dht22_capture.h) through the decoder and
+ *  reports correctness and throughput. Captures come from files, i.e. the
+ *  payloads of the <topic>/capture MQTT topic appended to a file, and/or are
+ *  synthesized from the waveform scenarios.
+ *
+ *  usage: dht22_replay [-s frames per scenario] [-w corpus out] [-r repeat] [capture files...]
+ *
+ *  Exits with 1 when a frame decodes to something else than its expected
+ *  value, or when a frame that was decoded when recorded does not decode now.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "dht22_capture.h"
+#include "waveform.h"
+#include "bench.h"
+
+#define SOURCES_MAX     64
+
+typedef struct
+{
+    dht22_capture_t capture;
+    uint16_t        source;
+} frame_t;
+
+typedef struct
+{
+    const char* name;
+    unsigned    frames;
+    unsigned    results[dht22_decode_checksum+1];
+    unsigned    correct;        // decoded and equal to the expected value
+    unsigned    wrong;          // decoded but not equal to the expected value
+    unsigned    fixed;          // failed when recorded, decode now
+    unsigned    regressed;      // decoded when recorded, fail now
+} source_t;
+
+static frame_t*  g_frames = NULL;
+static size_t    g_frames_count = 0;
+static size_t    g_frames_size = 0;
+static source_t  g_sources[SOURCES_MAX];
+static unsigned  g_sources_count = 0;
+
+static int add_source(const char* name)
+{
+    if(g_sources_count==SOURCES_MAX)
+    {
+        fprintf(stderr, "too many sources, %s ignored\n", name);
+        return -1;
+    }
+    memset(&g_sources[g_sources_count], 0, sizeof(source_t));
+    g_sources[g_sources_count].name = name;
+    return (int)g_sources_count++;
+}
+
+static frame_t* add_frame(int source)
+{
+    if(g_frames_count==g_frames_size)
+    {
+        g_frames_size = g_frames_size ? 2*g_frames_size : 1024;
+        g_frames = realloc(g_frames, g_frames_size*sizeof(frame_t));
+        if(!g_frames)
+        {
+            fprintf(stderr, "out of memory\n");
+            exit(2);
+        }
+    }
+    g_frames[g_frames_count].source = (uint16_t)source;
+    return &g_frames[g_frames_count++];
+}
+
+static void load_file(const char* path)
+{
+    size_t   sz, offset = 0;
+    uint8_t* buff = bench_load_file(path, &sz);
+    int      source;
+
+    if(!buff)
+        return;
+
+    source = add_source(path);
+    while(source>=0 && offset<sz)
+    {
+        frame_t* frame = add_frame(source);
+        size_t   n = dht22_capture_read(buff+offset, sz-offset, &frame->capture);
+
+        if(!n)
+        {
+            fprintf(stderr, "%s: invalid record at offset %zu, rest ignored\n", path, offset);
+            --g_frames_count;
+            break;
+        }
+        offset += n;
+    }
+    free(buff);
+}
+
+static void synthesize(unsigned frames)
+{
+    unsigned i, k;
+
+    for(i=0; i<WAVEFORM_SCENARIOS; ++i)
+    {
+        uint32_t seed = 0xC0FFEEu + i;
+        int      source = add_source(g_waveform_scenarios[i].name);
+
+        for(k=0; source>=0 && k<frames; ++k)
+        {
+            frame_t* frame = add_frame(source);
+            uint8_t  got[5];
+
+            waveform_raw(frame->capture.raw, &seed);
+            frame->capture.has_raw = true;
+            frame->capture.count = waveform_frame(&g_waveform_scenarios[i], frame->capture.raw, frame->capture.edges, &seed);
+            frame->capture.result = dht22_decode(frame->capture.edges, frame->capture.count, got, NULL);
+        }
+    }
+}
+
+static int write_corpus(const char* path)
+{
+    FILE*  f = fopen(path, "wb");
+    size_t i;
+
+    if(!f)
+    {
+        perror(path);
+        return 1;
+    }
+    for(i=0; i<g_frames_count; ++i)
+    {
+        const dht22_capture_t* c = &g_frames[i].capture;
+        uint8_t                buff[DHT22_CAPTURE_SZ_MAX];
+        size_t                 n = dht22_capture_write(buff, c->edges, c->count, c->result, c->has_raw ? c->raw : NULL);
+
+        fwrite(buff, 1, n, f);
+    }
+    fclose(f);
+    printf("%zu frames written to %s\n", g_frames_count, path);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    static const char* const results[] = { "ok", "short", "preamble", "timing", "checksum" };
+    const char* out = NULL;
+    unsigned    synthetic = 0, repeat = 20, r, i;
+    uint64_t    t0, ns;
+    size_t      k;
+    int         opt, status = 0;
+    volatile unsigned sink = 0;
+
+    while(-1!=(opt = getopt(argc, argv, "s:w:r:")))
+    {
+        switch(opt)
+        {
+            case 's': synthetic = (unsigned)strtoul(optarg, NULL, 0); break;
+            case 'w': out = optarg; break;
+            case 'r': repeat = (unsigned)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-s frames per scenario] [-w corpus out] [-r repeat] [capture files...]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    for(; optind<argc; ++optind)
+        load_file(argv[optind]);
+
+    if(synthetic)
+        synthesize(synthetic);
+
+    if(!g_frames_count)
+    {
+        fprintf(stderr, "no frames, give capture files and/or -s\n");
+        return 2;
+    }
+
+    if(out)
+        return write_corpus(out);
+
+    for(k=0; k<g_frames_count; ++k)
+    {
+        const dht22_capture_t* c = &g_frames[k].capture;
+        source_t*              s = &g_sources[g_frames[k].source];
+        uint8_t                got[5];
+        dht22_decode_result_t  result = dht22_decode(c->edges, c->count, got, NULL);
+
+        ++s->frames;
+        ++s->results[result];
+        if(dht22_decode_ok==result && c->has_raw)
+        {
+            if(memcmp(got, c->raw, 5))
+                ++s->wrong;
+            else
+                ++s->correct;
+        }
+        if(dht22_decode_ok==result && dht22_decode_ok!=c->result)
+            ++s->fixed;
+        if(dht22_decode_ok!=result && dht22_decode_ok==c->result)
+            ++s->regressed;
+    }
+
+    printf("%-24s %7s %7s %7s %7s %7s %7s %7s %7s %7s\n", "source", "frames",
+           results[0], results[1], results[2], results[3], results[4], "wrong", "fixed", "regress");
+    for(i=0; i<g_sources_count; ++i)
+    {
+        const source_t* s = &g_sources[i];
+
+        printf("%-24.24s %7u %7u %7u %7u %7u %7u %7u %7u %7u\n", s->name, s->frames,
+               s->results[0], s->results[1], s->results[2], s->results[3], s->results[4],
+               s->wrong, s->fixed, s->regressed);
+        if(s->wrong || s->regressed)
+            status = 1;
+    }
+
+    t0 = bench_now_ns();
+    for(r=0; r<repeat; ++r)
+    {
+        for(k=0; k<g_frames_count; ++k)
+        {
+            uint8_t got[5];
+
+            sink += dht22_decode(g_frames[k].capture.edges, g_frames[k].capture.count, got, NULL);
+        }
+    }
+    ns = bench_now_ns() - t0;
+
+    printf("throughput: %.0f frames/s, %.1f ns/frame over %zu frames x %u\n",
+           1e9*g_frames_count*repeat/ns, (double)ns/(g_frames_count*repeat), g_frames_count, repeat);
+
+    return status;
+}
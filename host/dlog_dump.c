@@ -0,0 +1,308 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      dlog_dump.c
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ *
+ *  Formats the deferred log records published on the <topic>/log MQTT topic
+ *  (see dlog.h), i.e. the payloads appended to a file, one line per record:
+ *
+ *      <time ms> <level> <message>
+ *
+ *  With -b it measures instead what a hot path pays per message: dlog_write
+ *  against formatting the same line with snprintf.
+ *
+ *  With -s it stress tests the ring: N writer threads race on dlog_write
+ *  while one thread reads. Every record must be either read exactly once, in
+ *  the order its writer wrote it, or dropped, and the dropped ones must add
+ *  up to what the DLOG_DROPPED records report. Records carry redundant
+ *  arguments so a torn one is caught.
+ *
+ *  usage: dlog_dump [-l max level 0..3] [log files...]
+ *         dlog_dump -b [iterations]
+ *         dlog_dump -s writers [records per writer]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "dlog.h"
+#include "bench.h"
+
+static uint32_t g_ms = 0;
+
+static uint32_t fake_clock(void)
+{
+    return g_ms;
+}
+
+static int dump(const char* path, unsigned level)
+{
+    size_t   sz, offset = 0;
+    uint8_t* buff = bench_load_file(path, &sz);
+
+    if(!buff)
+        return 1;
+
+    while(offset<sz)
+    {
+        dlog_record_t record;
+        char          s[128];
+        size_t        n = dlog_deserialize(buff+offset, sz-offset, &record);
+
+        if(!n)
+        {
+            fprintf(stderr, "%s: invalid record at offset %zu, rest ignored\n", path, offset);
+            free(buff);
+            return 1;
+        }
+        offset += n;
+
+        if(record.level>level)
+            continue;
+
+        dlog_format(s, sizeof(s), &record);
+        printf("%10u %s %s\n", record.time, dlog_level_name(record.level), s);
+    }
+    free(buff);
+    return 0;
+}
+
+static int bench(unsigned iterations)
+{
+    volatile int  sink = 0;
+    dlog_record_t record;
+    char          s[128];
+    uint64_t      t0, t_dlog, t_snprintf, t_format;
+    unsigned      i;
+
+    dlog_init(fake_clock);
+
+    t0 = bench_now_ns();
+    for(i=0; i<iterations; ++i)
+    {
+        ++g_ms;
+        sink += DLOG2(dlog_info, DLOG_DHT22_READ, 512 + (i&0xFF), 215 + (i&0x3F));
+        // Keep the ring from filling up, as the log task would
+        if(!(i&31))
+        {
+            while(dlog_read(&record))
+                ;
+        }
+    }
+    t_dlog = bench_now_ns() - t0;
+
+    t0 = bench_now_ns();
+    for(i=0; i<iterations; ++i)
+    {
+        int h = 512 + (i&0xFF), t = 215 + (i&0x3F);
+
+        sink += snprintf(s, sizeof(s), "DHT22 read successfully! humidity = %i.%u%%, temperature = %i.%u degrees",
+                         h/10, h%10, t/10, t%10);
+    }
+    t_snprintf = bench_now_ns() - t0;
+
+    record.argc = 2;
+    record.id = DLOG_DHT22_READ;
+    t0 = bench_now_ns();
+    for(i=0; i<iterations; ++i)
+    {
+        record.args[0] = 512 + (i&0xFF);
+        record.args[1] = 215 + (i&0x3F);
+        sink += dlog_format(s, sizeof(s), &record);
+    }
+    t_format = bench_now_ns() - t0;
+
+    printf("per message: dlog_write %.1f ns, snprintf %.1f ns (deferred dlog_format %.1f ns)\n",
+           (double)t_dlog/iterations, (double)t_snprintf/iterations, (double)t_format/iterations);
+    printf("(the hot path pays dlog_write; a UART at 115200 bauds adds ~%.1f ms per line to printf)\n",
+           (double)strlen(s)*10*1000/115200);
+    return 0;
+}
+
+typedef struct
+{
+    pthread_t   thread;
+    int32_t     writer;
+    uint32_t    count;
+    uint8_t*    dropped;        // bitmap, by sequence
+    uint64_t    dropped_count;
+    uint8_t*    read;           // bitmap, by sequence
+    int64_t     last;           // last sequence read
+} writer_t;
+
+static unsigned g_running = 0;
+
+static void check_args(int32_t writer, int32_t seq, int32_t* args)
+{
+    args[0] = writer;
+    args[1] = seq;
+    args[2] = ~seq;
+    args[3] = (int32_t)((uint32_t)writer*0x9E3779B9u ^ (uint32_t)seq);
+}
+
+static void* writer_thread(void* arg)
+{
+    writer_t* w = arg;
+    uint32_t  seq;
+
+    for(seq=0; seq<w->count; ++seq)
+    {
+        int32_t args[DLOG_ARGS_MAX];
+
+        check_args(w->writer, (int32_t)seq, args);
+        if(!dlog_write(dlog_info, DLOG_SENSOR, DLOG_ARGS_MAX, args))
+        {   // Give the reader a chance, so the ring stays busy rather than full
+            w->dropped[seq/8] |= 1<<(seq%8);
+            ++w->dropped_count;
+            sched_yield();
+        }
+    }
+    __atomic_sub_fetch(&g_running, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static int stress(unsigned writers, uint32_t count)
+{
+    writer_t*     w = calloc(writers, sizeof(writer_t));
+    dlog_record_t record;
+    uint64_t      t0, t, read = 0, reported = 0, dropped = 0, missing = 0, duplicated = 0, torn = 0, disordered = 0;
+    unsigned      k;
+    uint32_t      seq;
+
+    dlog_init(fake_clock);
+    dlog_set_level(dlog_debug);
+
+    g_running = writers;
+    for(k=0; k<writers; ++k)
+    {
+        w[k].writer = (int32_t)k;
+        w[k].count = count;
+        w[k].dropped = calloc((count+7)/8, 1);
+        w[k].read = calloc((count+7)/8, 1);
+        w[k].last = -1;
+    }
+
+    t0 = bench_now_ns();
+    for(k=0; k<writers; ++k)
+        pthread_create(&w[k].thread, NULL, writer_thread, &w[k]);
+
+    for(;;)
+    {
+        // Once every writer is done, one more pass drains what is left
+        bool done = 0==__atomic_load_n(&g_running, __ATOMIC_ACQUIRE);
+
+        while(dlog_read(&record))
+        {
+            int32_t args[DLOG_ARGS_MAX];
+
+            if(DLOG_DROPPED==record.id && 1==record.argc)
+            {
+                reported += (uint32_t)record.args[0];
+                continue;
+            }
+
+            if(DLOG_SENSOR!=record.id || DLOG_ARGS_MAX!=record.argc || dlog_info!=record.level ||
+               record.args[0]<0 || (unsigned)record.args[0]>=writers || (uint32_t)record.args[1]>=count)
+            {
+                ++torn;
+                continue;
+            }
+
+            check_args(record.args[0], record.args[1], args);
+            if(memcmp(args, record.args, sizeof(args)))
+            {
+                ++torn;
+                continue;
+            }
+
+            k = (unsigned)record.args[0];
+            seq = (uint32_t)record.args[1];
+            if(w[k].read[seq/8] & 1<<(seq%8))
+                ++duplicated;
+            if((int64_t)seq<=w[k].last)
+                ++disordered;
+            w[k].read[seq/8] |= 1<<(seq%8);
+            w[k].last = seq;
+            ++read;
+        }
+
+        if(done)
+            break;
+        sched_yield();
+    }
+    t = bench_now_ns() - t0;
+
+    for(k=0; k<writers; ++k)
+    {
+        pthread_join(w[k].thread, NULL);
+        dropped += w[k].dropped_count;
+
+        for(seq=0; seq<count; ++seq)
+        {
+            bool r = w[k].read[seq/8] & 1<<(seq%8);
+            bool d = w[k].dropped[seq/8] & 1<<(seq%8);
+
+            missing += (r==d);  // neither, or read a record its writer saw dropped
+        }
+        free(w[k].dropped);
+        free(w[k].read);
+    }
+    free(w);
+
+    printf("%u writers x %u records in %.1f ms: read %llu, dropped %llu (reported %llu)\n",
+           writers, count, t/1e6, (unsigned long long)read, (unsigned long long)dropped, (unsigned long long)reported);
+    printf("missing %llu, duplicated %llu, out of order %llu, torn %llu\n",
+           (unsigned long long)missing, (unsigned long long)duplicated, (unsigned long long)disordered, (unsigned long long)torn);
+
+    if(missing || duplicated || disordered || torn || dropped!=reported || read+dropped!=(uint64_t)writers*count)
+    {
+        printf("FAIL\n");
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned level = dlog_debug, writers = 0;
+    int      opt, status = 0, benchmark = 0;
+
+    while(-1!=(opt = getopt(argc, argv, "l:bs:")))
+    {
+        switch(opt)
+        {
+            case 'l': level = (unsigned)strtoul(optarg, NULL, 0); break;
+            case 'b': benchmark = 1; break;
+            case 's': writers = (unsigned)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-l max level 0..3] [log files...]\n"
+                                "       %s -b [iterations]\n"
+                                "       %s -s writers [records per writer]\n", argv[0], argv[0], argv[0]);
+                return 2;
+        }
+    }
+
+    if(benchmark)
+        return bench(optind<argc ? (unsigned)strtoul(argv[optind], NULL, 0) : 1000000);
+
+    if(writers)
+        return stress(writers, optind<argc ? (uint32_t)strtoul(argv[optind], NULL, 0) : 100000);
+
+    if(optind==argc)
+    {
+        fprintf(stderr, "no log files\n");
+        return 2;
+    }
+
+    for(; optind<argc; ++optind)
+        status |= dump(argv[optind], level);
+
+    return status;
+}
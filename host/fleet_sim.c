@@ -0,0 +1,299 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      fleet_sim.c
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ *
+ *  Runs a fleet of virtual thermostats, each one the real main.c and comm.c
+ *  (libthermostat.so, see device.h), against the in-process broker stand-in,
+ *  while a controller sends them commands and waits for the acks.
+ *
+ *  Every device gets one command per period, s=<value> or, with -b, the batch
+ *  s=<value>;d=5;m=auto, with at most one in flight; the ack is the S=<value>
+ *  frame (the first one of the batch ack) on the device topic. Device time
+ *  runs speed times faster so the 5 s control cycle, and its telemetry, come
+ *  speed times more often than on a real board.
+ *
+ *  For each fleet size it reports the command to ack latency, the messages
+ *  published per device per second and the broker load.
+ *
+ *  usage: fleet_sim [-n sizes, i.e. 1,10,100] [-d seconds per size] [-x speed]
+ *                   [-c command period ms] [-t ack timeout ms] [-b]
+ *                   [-s steady|swing|flaky] [-l libthermostat.so] [-v]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "sdkconfig.h"
+#include "device.h"
+#include "broker.h"
+#include "bench.h"
+
+#define SIZES_MAX   16
+
+typedef struct
+{
+    bool        pending;
+    int         value;
+    unsigned    seq;
+    uint64_t    sent_ns;
+    uint64_t    next_ns;
+} command_t;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static command_t*      g_commands = NULL;
+static unsigned        g_count = 0;
+static uint64_t*       g_latencies = NULL;
+static size_t          g_latencies_count = 0;
+static size_t          g_latencies_size = 0;
+static uint64_t        g_received = 0;
+
+static int compare(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+
+    return (x>y) - (x<y);
+}
+
+static double percentile(double q)
+{
+    if(!g_latencies_count)
+        return 0;
+
+    return g_latencies[(size_t)((g_latencies_count-1)*q)]/1000.0;
+}
+
+/**
+ *  Controller side: everything the devices publish on their default topic.
+ */
+static void on_controller(void* ctx, const char* topic, const char* data, size_t len)
+{
+    uint64_t   now = bench_now_ns();
+    char*      end;
+    unsigned   id;
+    long       value;
+    command_t* c;
+
+    __atomic_add_fetch(&g_received, 1, __ATOMIC_RELAXED);
+
+    if(strncmp(topic, "fleet/", 6) || len<3 || 'S'!=data[0] || '='!=data[1])
+        return;
+
+    id = (unsigned)strtoul(topic+6, &end, 10);
+    if(id>=g_count || strcmp(end, CONFIG_MQTT_TOPIC_DEFAULT))
+        return;
+
+    value = strtol(data+2, &end, 10);
+    if(*end && ';'!=*end)
+        return;
+
+    pthread_mutex_lock(&g_lock);
+    c = &g_commands[id];
+    if(c->pending && value==c->value)
+    {
+        c->pending = false;
+        if(g_latencies_count==g_latencies_size)
+        {
+            g_latencies_size = g_latencies_size ? 2*g_latencies_size : 4096;
+            g_latencies = realloc(g_latencies, g_latencies_size*sizeof(uint64_t));
+        }
+        g_latencies[g_latencies_count++] = now - c->sent_ns;
+    }
+    pthread_mutex_unlock(&g_lock);
+}
+
+static uint64_t published(const device_t* devices, unsigned count)
+{
+    uint64_t n = 0;
+    unsigned i;
+
+    for(i=0; i<count; ++i)
+        n += __atomic_load_n(&devices[i].published, __ATOMIC_RELAXED);
+    return n;
+}
+
+static bool run(unsigned count, unsigned seconds, unsigned speed, unsigned period_ms, unsigned timeout_ms, bool batch)
+{
+    device_t*        devices = calloc(count, sizeof(device_t));
+    broker_client_t* controller;
+    broker_stats_t   s0, s1;
+    uint64_t         p0, p1, t0, t1, end, commands = 0, timeouts = 0, relays = 0, period = period_ms*1000000ull;
+    unsigned         i, started;
+    char             filter[64];
+
+    g_commands = calloc(count, sizeof(command_t));
+    g_count = count;
+    g_latencies_count = 0;
+    g_received = 0;
+
+    device_clock_start(speed);
+    broker_start();
+
+    controller = broker_connect(on_controller, NULL, NULL);
+    snprintf(filter, sizeof(filter), "fleet/+%s", CONFIG_MQTT_TOPIC_DEFAULT);
+    broker_subscribe(controller, filter);
+
+    for(started=0; started<count && device_start(&devices[started], started); ++started)
+        ;
+    if(started<count)
+    {
+        fprintf(stderr, "only %u devices started\n", started);
+        device_stop(devices, started);
+        broker_stop();
+        device_release(devices, started);
+        free(devices);
+        free(g_commands);
+        return false;
+    }
+
+    // Until every device said BEGIN!
+    for(t0=bench_now_ns(); bench_now_ns()-t0<2000000000ull; usleep(1000))
+    {
+        for(i=0; i<count && __atomic_load_n(&devices[i].published, __ATOMIC_RELAXED); ++i)
+            ;
+        if(i==count)
+            break;
+    }
+
+    t0 = bench_now_ns();
+    for(i=0; i<count; ++i)
+        g_commands[i].next_ns = t0 + period*i/count;
+
+    broker_read_stats(&s0);
+    p0 = published(devices, count);
+
+    for(end=t0+seconds*1000000000ull; bench_now_ns()<end; usleep(500))
+    {
+        for(i=0; i<count; ++i)
+        {
+            command_t* c = &g_commands[i];
+            uint64_t   now = bench_now_ns();
+            char       topic[64], s[32];
+            int        n;
+
+            pthread_mutex_lock(&g_lock);
+            if(c->pending && now - c->sent_ns > timeout_ms*1000000ull)
+            {
+                c->pending = false;
+                ++timeouts;
+            }
+            if(c->pending || now<c->next_ns)
+            {
+                pthread_mutex_unlock(&g_lock);
+                continue;
+            }
+
+            c->value = 200 + 2*(c->seq++%50);
+            c->pending = true;
+            c->sent_ns = now;
+            c->next_ns = (c->next_ns+period>now) ? c->next_ns+period : now+period;
+            pthread_mutex_unlock(&g_lock);
+
+            snprintf(topic, sizeof(topic), "fleet/%u%s", i, CONFIG_MQTT_TOPIC_DEFAULT);
+            n = batch ? snprintf(s, sizeof(s), "s=%d;d=5;m=auto", c->value)
+                      : snprintf(s, sizeof(s), "s=%d", c->value);
+            broker_publish(topic, s, n);
+            ++commands;
+        }
+    }
+
+    t1 = bench_now_ns();
+    broker_read_stats(&s1);
+    p1 = published(devices, count);
+
+    device_stop(devices, count);
+    broker_stop();
+    device_release(devices, count);
+
+    for(i=0; i<count; ++i)
+    {
+        relays += devices[i].relay_switches;
+        timeouts += g_commands[i].pending;
+    }
+
+    qsort(g_latencies, g_latencies_count, sizeof(uint64_t), compare);
+    printf("%7u %8llu %8zu %7llu %9.1f %9.1f %9.1f %10.1f %11.0f %11.0f %6.1f%% %8llu\n",
+           count, (unsigned long long)commands, g_latencies_count, (unsigned long long)timeouts,
+           percentile(0.5), percentile(0.99), percentile(1.0),
+           1e9*(p1-p0)/(t1-t0)/count,
+           1e9*(s1.published-s0.published)/(t1-t0),
+           1e9*(s1.delivered-s0.delivered)/(t1-t0),
+           100.0*(s1.busy_ns-s0.busy_ns)/(t1-t0),
+           (unsigned long long)relays);
+    fflush(stdout);
+
+    free(devices);
+    free(g_commands);
+    g_commands = NULL;
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned sizes[SIZES_MAX] = { 1, 10, 50, 100, 200 };
+    unsigned sizes_count = 5, seconds = 5, speed = 100, period_ms = 250, timeout_ms = 1000, i;
+    const char* image = "./libthermostat.so";
+    bool     batch = false;
+    int      opt;
+
+    while(-1!=(opt = getopt(argc, argv, "n:d:x:c:t:bs:l:v")))
+    {
+        switch(opt)
+        {
+            case 'n':
+            {
+                char* p = optarg;
+
+                for(sizes_count=0; *p && sizes_count<SIZES_MAX; p+=(','==*p))
+                    sizes[sizes_count++] = (unsigned)strtoul(p, &p, 0);
+            } break;
+            case 'd': seconds = (unsigned)strtoul(optarg, NULL, 0); break;
+            case 'x': speed = (unsigned)strtoul(optarg, NULL, 0); break;
+            case 'c': period_ms = (unsigned)strtoul(optarg, NULL, 0); break;
+            case 't': timeout_ms = (unsigned)strtoul(optarg, NULL, 0); break;
+            case 'b': batch = true; break;
+            case 's':
+            {
+                if(0==strcmp(optarg, "steady"))     device_set_sensor(device_sensor_steady);
+                else if(0==strcmp(optarg, "swing")) device_set_sensor(device_sensor_swing);
+                else if(0==strcmp(optarg, "flaky")) device_set_sensor(device_sensor_flaky);
+                else
+                {
+                    fprintf(stderr, "unknown sensor scenario %s\n", optarg);
+                    return 2;
+                }
+            } break;
+            case 'l': image = optarg; break;
+            case 'v': device_set_verbose(true); break;
+            default:
+                fprintf(stderr, "usage: %s [-n sizes, i.e. 1,10,100] [-d seconds per size] [-x speed]\n"
+                                "          [-c command period ms] [-t ack timeout ms] [-b]\n"
+                                "          [-s steady|swing|flaky] [-l libthermostat.so] [-v]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    if(!device_load(image))
+        return 2;
+
+    printf("%u s per fleet size, device time x%u, one %s per device every %u ms\n",
+           seconds, speed, batch ? "batch" : "command", period_ms);
+    printf("%7s %8s %8s %7s %9s %9s %9s %10s %11s %11s %7s %8s\n", "devices", "commands", "acked", "lost",
+           "p50 us", "p99 us", "max us", "msg/s/dev", "broker in/s", "out/s", "busy", "relays");
+
+    for(i=0; i<sizes_count; ++i)
+    {
+        if(!sizes[i] || !run(sizes[i], seconds, speed, period_ms, timeout_ms, batch))
+            break;
+    }
+
+    device_unload();
+    free(g_latencies);
+    return 0;
+}
@@ -0,0 +1,158 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      fmt_bench.c
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ *
+ *  Compares the telemetry frame formatting of send_value/send_mode done with
+ *  sprintf against the fmt writers: ns per formatted message and peak stack.
+ *
+ *  usage: fmt_bench [iterations]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "fmt.h"
+#include "bench.h"
+
+#define BENCH_STACK_SIZE    (64*1024)
+
+static const char* const g_modes[] = { "off", "auto", "heat" };
+
+// Something close to what app_main publishes over a 12 cycles period
+static const struct
+{
+    char opcode;
+    int  value;
+} g_frames[] = {
+    { 'T', 215 }, { 'H', 487 }, { 'S', 250 }, { 'D', 5 },
+    { 'O', 1 },   { 'T', -73 }, { 'H', 1000 }, { 'O', 0 },
+};
+
+#define FRAMES_COUNT (sizeof(g_frames)/sizeof(g_frames[0]))
+
+static volatile size_t g_sink;
+
+static size_t frame_sprintf(char* s, unsigned k)
+{
+    if(k%(FRAMES_COUNT+1)==FRAMES_COUNT)
+        return sprintf(s, "M=%s", g_modes[k%3]);
+
+    k %= FRAMES_COUNT+1;
+    return sprintf(s, "%c=%d", g_frames[k].opcode&0xDF, g_frames[k].value + (int)(k&7));
+}
+
+static size_t frame_fmt(char* s, unsigned k)
+{
+    if(k%(FRAMES_COUNT+1)==FRAMES_COUNT)
+    {
+        s[0] = 'M';
+        s[1] = '=';
+        return 2 + fmt_str(s+2, g_modes[k%3]);
+    }
+
+    k %= FRAMES_COUNT+1;
+    return fmt_value(s, g_frames[k].opcode, g_frames[k].value + (int)(k&7));
+}
+
+typedef struct
+{
+    size_t   (*frame)(char* s, unsigned k);
+    unsigned iterations;
+} run_t;
+
+static void run(void* arg)
+{
+    run_t* r = arg;
+    size_t total = 0;
+    unsigned k;
+
+    for(k=0; k<r->iterations; ++k)
+    {
+        char s[FMT_VALUE_SZ];
+
+        total += r->frame(s, k);
+        total += (unsigned char)s[0];
+    }
+    g_sink = total;
+}
+
+static void nothing(void* arg)
+{
+    (void)arg;
+}
+
+static int check(void)
+{
+    unsigned k;
+    int      errors = 0;
+
+    for(k=0; k<10*(FRAMES_COUNT+1); ++k)
+    {
+        char a[32];
+        char b[FMT_VALUE_SZ];
+
+        frame_sprintf(a, k);
+        frame_fmt(b, k);
+        if(strcmp(a, b))
+        {
+            printf("mismatch: sprintf [%s] fmt [%s]\n", a, b);
+            ++errors;
+        }
+    }
+
+    for(k=0; k<2000; ++k)
+    {
+        int32_t v = (int32_t)k*7919 - 5000000;
+        char    a[32];
+        char    b[FMT_TENTHS_LEN_MAX+1];
+
+        sprintf(a, "%s%d.%d", v<0 ? "-" : "", abs(v/10), abs(v%10));
+        fmt_tenths(b, v);
+        if(strcmp(a, b))
+        {
+            printf("mismatch: tenths [%s] fmt [%s]\n", a, b);
+            ++errors;
+        }
+    }
+    return errors;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned iterations = (argc>1) ? (unsigned)strtoul(argv[1], NULL, 0) : 2000000;
+    run_t    r_sprintf = { frame_sprintf, iterations };
+    run_t    r_fmt = { frame_fmt, iterations };
+    size_t   base, stack_sprintf, stack_fmt;
+    uint64_t t0, t_sprintf, t_fmt;
+
+    if(check())
+        return 1;
+
+    // Warm up, then time
+    run(&r_sprintf);
+    run(&r_fmt);
+
+    t0 = bench_now_ns();
+    run(&r_sprintf);
+    t_sprintf = bench_now_ns() - t0;
+
+    t0 = bench_now_ns();
+    run(&r_fmt);
+    t_fmt = bench_now_ns() - t0;
+
+    r_sprintf.iterations = r_fmt.iterations = 4*(FRAMES_COUNT+1);
+    base = bench_stack_peak(nothing, NULL, BENCH_STACK_SIZE);
+    stack_sprintf = bench_stack_peak(run, &r_sprintf, BENCH_STACK_SIZE);
+    stack_fmt = bench_stack_peak(run, &r_fmt, BENCH_STACK_SIZE);
+
+    printf("messages    : %u\n", iterations);
+    printf("sprintf     : %6.1f ns/msg  %5zu bytes of stack\n", (double)t_sprintf/iterations, stack_sprintf-base);
+    printf("fmt         : %6.1f ns/msg  %5zu bytes of stack\n", (double)t_fmt/iterations, stack_fmt-base);
+    printf("(stack is over the %zu bytes a bare thread uses)\n", base);
+
+    return 0;
+}
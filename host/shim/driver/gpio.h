@@ -0,0 +1,48 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      driver/gpio.h
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ *
+ *  Host shim: relays are recorded per device.
+ */
+#ifndef GPIO_H
+#define GPIO_H
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+typedef enum
+{
+    GPIO_NUM_19 = 19
+,   GPIO_NUM_21 = 21
+,   GPIO_NUM_22 = 22
+,   GPIO_NUM_23 = 23
+,   GPIO_NUM_MAX = 40
+} gpio_num_t;
+
+#define GPIO_MODE_INPUT         1
+#define GPIO_MODE_OUTPUT        2
+#define GPIO_PULLUP_DISABLE     0
+#define GPIO_PULLDOWN_DISABLE   0
+#define GPIO_INTR_DISABLE       0
+
+// Pads 20, 24 and 28..31 are not bonded, 34..39 are inputs only
+#define GPIO_IS_VALID_GPIO(n)           ((n)>=0 && (n)<GPIO_NUM_MAX && ((0xFF0EEFFFFFULL>>(n)) & 1))
+#define GPIO_IS_VALID_OUTPUT_GPIO(n)    (GPIO_IS_VALID_GPIO(n) && (n)<34)
+
+typedef struct
+{
+    uint64_t    pin_bit_mask;
+    int         mode;
+    int         pull_up_en;
+    int         pull_down_en;
+    int         intr_type;
+} gpio_config_t;
+
+esp_err_t gpio_config(const gpio_config_t* config);
+esp_err_t gpio_set_level(int pin, uint32_t level);
+
+#endif
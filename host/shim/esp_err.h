@@ -0,0 +1,22 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      esp_err.h
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ *
+ *  Host shim.
+ */
+#ifndef ESP_ERR_H
+#define ESP_ERR_H
+
+#include <stdlib.h>
+
+typedef int esp_err_t;
+
+#define ESP_OK      0
+#define ESP_FAIL    -1
+
+#define ESP_ERROR_CHECK(x)  do { if(ESP_OK!=(x)) abort(); } while(0)
+
+#endif
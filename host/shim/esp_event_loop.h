@@ -0,0 +1,32 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      esp_event_loop.h
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ *
+ *  Host shim: the events are raised synchronously, see device.c.
+ */
+#ifndef ESP_EVENT_LOOP_H
+#define ESP_EVENT_LOOP_H
+
+#include "esp_err.h"
+
+typedef enum
+{
+    SYSTEM_EVENT_STA_START
+,   SYSTEM_EVENT_STA_GOT_IP
+,   SYSTEM_EVENT_STA_DISCONNECTED
+} system_event_id_t;
+
+typedef struct
+{
+    system_event_id_t   event_id;
+} system_event_t;
+
+typedef esp_err_t (*system_event_cb_t)(void* ctx, system_event_t* event);
+
+esp_err_t esp_event_loop_init(system_event_cb_t cb, void* ctx);
+void      tcpip_adapter_init(void);
+
+#endif
@@ -0,0 +1,20 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      esp_log.h
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ *
+ *  Host shim: shown with fleet_sim -v only.
+ */
+#ifndef ESP_LOG_H
+#define ESP_LOG_H
+
+int device_printf(const char* format, ...) __attribute__((format(__printf__, 1, 2)));
+
+#define ESP_LOGE(tag, format, ...)  device_printf("E %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...)  device_printf("W %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...)  device_printf("I %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...)  device_printf("D %s: " format "\n", tag, ##__VA_ARGS__)
+
+#endif
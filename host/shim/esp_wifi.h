@@ -0,0 +1,45 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      esp_wifi.h
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ *
+ *  Host shim: the station is connected as soon as it starts.
+ */
+#ifndef ESP_WIFI_H
+#define ESP_WIFI_H
+
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_event_loop.h"
+
+typedef enum { WIFI_MODE_STA = 1 } wifi_mode_t;
+typedef enum { WIFI_STORAGE_RAM = 1 } wifi_storage_t;
+typedef enum { ESP_IF_WIFI_STA } esp_interface_t;
+
+typedef struct
+{
+    int         unused;
+} wifi_init_config_t;
+
+typedef union
+{
+    struct
+    {
+        uint8_t ssid[32];
+        uint8_t password[64];
+    } sta;
+} wifi_config_t;
+
+#define WIFI_INIT_CONFIG_DEFAULT()  { 0 }
+
+esp_err_t esp_wifi_init(const wifi_init_config_t* config);
+esp_err_t esp_wifi_set_storage(wifi_storage_t storage);
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode);
+esp_err_t esp_wifi_set_config(esp_interface_t interface, wifi_config_t* config);
+esp_err_t esp_wifi_start(void);
+esp_err_t esp_wifi_connect(void);
+
+#endif
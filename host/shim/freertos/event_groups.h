@@ -0,0 +1,10 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      freertos/event_groups.h
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ *
+ *  Host shim, nothing from here is used.
+ */
+#include "freertos/FreeRTOS.h"
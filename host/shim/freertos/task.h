@@ -0,0 +1,23 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      freertos/task.h
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ *
+ *  Host shim.
+ */
+#ifndef TASK_H
+#define TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef void  (*TaskFunction_t)(void* arg);
+typedef void* TaskHandle_t;
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t depth, void* arg, UBaseType_t priority, TaskHandle_t* handle);
+void       vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+TickType_t xTaskGetTickCountFromISR(void);
+
+#endif
@@ -0,0 +1,57 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      mqtt.h
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ *
+ *  Host shim of the esp32 mqtt client API comm.c uses; the client talks to
+ *  the in-process broker, see device.c and broker.c.
+ */
+#ifndef MQTT_H
+#define MQTT_H
+
+#include <stdint.h>
+
+typedef struct mqtt_client mqtt_client;
+
+typedef struct
+{
+    const char* topic;
+    const char* data;
+    uint16_t    topic_length;
+    uint16_t    data_length;
+    uint16_t    data_offset;
+    uint16_t    data_total_length;
+} mqtt_event_data_t;
+
+typedef void (*mqtt_callback)(mqtt_client* client, mqtt_event_data_t* event_data);
+
+typedef struct
+{
+    mqtt_callback   connected_cb;
+    mqtt_callback   disconnected_cb;
+    mqtt_callback   reconnect_cb;
+    mqtt_callback   subscribe_cb;
+    mqtt_callback   publish_cb;
+    mqtt_callback   data_cb;
+
+    char            host[64];
+    uint32_t        port;
+    char            client_id[32];
+    char            username[32];
+    char            password[32];
+    char            lwt_topic[64];
+    char            lwt_msg[32];
+    uint32_t        lwt_qos;
+    uint32_t        lwt_retain;
+    uint32_t        clean_session;
+    uint32_t        keepalive;
+} mqtt_settings;
+
+void mqtt_start(mqtt_settings* settings);
+void mqtt_stop(void);
+void mqtt_subscribe(mqtt_client* client, const char* topic, uint8_t qos);
+void mqtt_publish(mqtt_client* client, const char* topic, const char* data, int len, int qos, int retain);
+
+#endif
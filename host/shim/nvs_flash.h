@@ -0,0 +1,12 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      nvs_flash.h
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ *
+ *  Host shim.
+ */
+#include "esp_err.h"
+
+esp_err_t nvs_flash_init(void);
@@ -0,0 +1,20 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      sdkconfig.h
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ *
+ *  Host shim: the configuration the firmware is built with for fleet_sim.
+ */
+#define CONFIG_WIFI_SSID                    "fleet"
+#define CONFIG_WIFI_PASSWORD                "fleet"
+#define CONFIG_MQTT_BROKER_ADDRESS          "127.0.0.1"
+#define CONFIG_MQTT_TOPIC_DEFAULT           "/thermostat"
+#define CONFIG_THERMOSTAT_ZONE_PINS         "23"
+#define CONFIG_THERMOSTAT_REMOTE_SENSORS    0
+#define CONFIG_THERMOSTAT_STATS_WINDOW      12
+#define CONFIG_THERMOSTAT_RAW_TELEMETRY     1
+#define CONFIG_DHT22_CAPTURE_RING           4
+#define CONFIG_DLOG_RING_SIZE               64
+#define CONFIG_DLOG_PUBLISH                 1
@@ -0,0 +1,118 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      waveform.c
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "waveform.h"
+
+/**
+ *  Off-nominal conditions seen in the field: clone sensors, clock deviation,
+ *  rising edge skew on long cables and edge jitter.
+ */
+const waveform_t g_waveform_scenarios[WAVEFORM_SCENARIOS] = {
+    WAVEFORM_NOMINAL("nominal")
+,   { "clone sensor",       1.00,  0.0, 0.0, 22.0, 65.0, 55.0, 75.0, false }
+,   { "response edge",      1.00,  0.0, 0.0, 27.0, 70.0, 50.0, 80.0, true  }
+,   { "slow clock -15%",    1.15,  0.0, 0.0, 27.0, 70.0, 50.0, 80.0, false }
+,   { "fast clock +15%",    0.85,  0.0, 0.0, 27.0, 70.0, 50.0, 80.0, false }
+,   { "cable skew 8us",     1.00,  8.0, 0.0, 27.0, 70.0, 50.0, 80.0, false }
+,   { "cable skew 14us",    1.00, 14.0, 0.0, 27.0, 70.0, 50.0, 80.0, false }
+,   { "jitter 2us",         1.00,  0.0, 2.0, 27.0, 70.0, 50.0, 80.0, false }
+,   { "jitter 5us",         1.00,  0.0, 5.0, 27.0, 70.0, 50.0, 80.0, false }
+,   { "skew 10 jitter 3",   1.10, 10.0, 3.0, 24.0, 68.0, 52.0, 78.0, false }
+};
+
+// The isr gives the semaphore, and stops queueing, after this many edges
+#define ISR_EDGES   83
+
+uint32_t waveform_random(uint32_t* seed)
+{
+    uint32_t x = *seed;
+
+    x ^= x<<13;
+    x ^= x>>17;
+    x ^= x<<5;
+    return *seed = x;
+}
+
+static double uniform(uint32_t* seed)
+{
+    return (waveform_random(seed) + 0.5) / 4294967296.0;
+}
+
+static double gaussian(uint32_t* seed)
+{
+    return sqrt(-2.0*log(uniform(seed))) * cos(2.0*M_PI*uniform(seed));
+}
+
+/**
+ *  A plausible reading: 20..90 %, -10..40 celsius degrees and a good checksum.
+ */
+void waveform_raw(uint8_t raw[5], uint32_t* seed)
+{
+    uint16_t h = 200 + waveform_random(seed)%701;
+    int16_t  t = (int16_t)(waveform_random(seed)%501) - 100;
+    uint16_t u = (t<0) ? (0x8000 | (uint16_t)-t) : (uint16_t)t;
+
+    raw[0] = h>>8;
+    raw[1] = h&0xFF;
+    raw[2] = u>>8;
+    raw[3] = u&0xFF;
+    raw[4] = raw[0] + raw[1] + raw[2] + raw[3];
+}
+
+static size_t edge(const waveform_t* w, dht22_edge_t* edges, size_t n, double t, uint8_t level, uint32_t* seed)
+{
+    if(n<ISR_EDGES)
+    {
+        if(level)
+            t += w->skew_us;
+        if(w->jitter_us>0)
+            t += w->jitter_us*gaussian(seed);
+
+        edges[n].time = (uint32_t)lround(t*DHT22_TICKS_PER_US);
+        edges[n].level = level;
+        ++n;
+    }
+    return n;
+}
+
+/**
+ *  Fills edges, that must hold DHT22_EDGES_MAX, and returns how many the isr
+ *  would have queued.
+ */
+size_t waveform_frame(const waveform_t* w, const uint8_t raw[5], dht22_edge_t* edges, uint32_t* seed)
+{
+    double t = 30.0;    // the sensor answers 20..40 us after the host releases the line
+    size_t n = 0;
+    int    b;
+
+    if(w->response_edge)
+        n = edge(w, edges, n, t, 0, seed);
+
+    t += w->response_us*w->clock;
+    n = edge(w, edges, n, t, 1, seed);
+    t += w->response_us*w->clock;
+    n = edge(w, edges, n, t, 0, seed);
+
+    for(b=0; b<DHT22_BITS; ++b)
+    {
+        t += w->low_us*w->clock;
+        n = edge(w, edges, n, t, 1, seed);
+        t += ((raw[b/8]<<(b%8)) & 0x80 ? w->one_us : w->zero_us)*w->clock;
+        n = edge(w, edges, n, t, 0, seed);
+    }
+
+    // The sensor releases the line after a last low
+    t += w->low_us*w->clock;
+    n = edge(w, edges, n, t, 1, seed);
+
+    return n;
+}
@@ -0,0 +1,42 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      waveform.h
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ */
+#ifndef WAVEFORM_H
+#define WAVEFORM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "dht22_decode.h"
+
+/**
+ *  Synthetic DHT22 frames, as the isr would timestamp them.
+ */
+typedef struct
+{
+    const char* name;
+    double      clock;          // sensor time scale, 1.0 is nominal
+    double      skew_us;        // rising edges are seen this much later
+    double      jitter_us;      // gaussian sigma added to every edge
+    double      zero_us;        // bit high times, nominal 27 and 70
+    double      one_us;
+    double      low_us;         // bit low time, nominal 50
+    double      response_us;    // response low and high, nominal 80
+    bool        response_edge;  // the isr catches the response falling edge too
+} waveform_t;
+
+#define WAVEFORM_NOMINAL(name)  { name, 1.0, 0.0, 0.0, 27.0, 70.0, 50.0, 80.0, false }
+#define WAVEFORM_SCENARIOS      10
+
+extern const waveform_t g_waveform_scenarios[WAVEFORM_SCENARIOS];
+
+uint32_t waveform_random(uint32_t* seed);
+void     waveform_raw(uint8_t raw[5], uint32_t* seed);
+size_t   waveform_frame(const waveform_t* w, const uint8_t raw[5], dht22_edge_t* edges, uint32_t* seed);
+
+#endif
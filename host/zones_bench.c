@@ -0,0 +1,199 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      zones_bench.c
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ *
+ *  Cost of one control tick as the zone count grows: zones_evaluate over the
+ *  struct of arrays table against the former per zone thermostat_evaluate
+ *  logic run over an array of thermostat_internals_t like structs.
+ *
+ *  Built with a larger ZONES_MAX than the firmware, see the Makefile.
+ *
+ *  usage: zones_bench [ticks per zone count]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "zones.h"
+#include "bench.h"
+
+#define SENSORS     16
+#define SNAPSHOTS   64      // sensor states the ticks cycle through
+#define REPEATS     5
+
+// What g_thermostat_internals held for its only zone
+typedef struct
+{
+    int16_t             setpoint;
+    int16_t             hysteresis;
+    int16_t             temperature;
+    thermostat_mode_t   mode;
+    bool                output;
+    uint16_t            humidity;
+    int16_t             dew_point;
+    int16_t             heat_index;
+    int16_t             dew_point_limit;
+    uint8_t             sensor;
+} internals_t;
+
+static zone_table_t   g_zones;
+static zone_sensors_t g_sensors;
+static zone_sensors_t g_snapshots[SNAPSHOTS];
+static internals_t    g_internals[ZONES_MAX];
+static uint16_t       g_changed[ZONES_MAX];
+
+static uint32_t next(uint32_t* seed)
+{
+    *seed = *seed*1664525u + 1013904223u;
+    return *seed>>8;
+}
+
+/**
+ *  The former thermostat_evaluate, minus the gpio call, returning whether
+ *  the output changed.
+ */
+static bool legacy_evaluate(internals_t* i)
+{
+    bool output = i->output;
+
+    switch(i->mode)
+    {
+        case tm_off:
+        case tm_heat:
+        {
+            i->output = (tm_heat==i->mode);
+        } break;
+        case tm_auto:
+        {
+            int16_t threshold = i->setpoint + (i->output ? i->hysteresis : - i->hysteresis);
+
+            i->output = (i->temperature<threshold);
+        } break;
+        case tm_cool:
+        {
+            int16_t threshold = i->setpoint - (i->output ? i->hysteresis : - i->hysteresis);
+
+            i->output = (i->temperature>threshold) && (i->dew_point<i->dew_point_limit);
+        }
+    }
+    return output!=i->output;
+}
+
+static void setup(uint16_t count, uint32_t seed)
+{
+    uint8_t  pins[ZONES_MAX] = { 0 };
+    uint16_t z;
+
+    zones_init(&g_zones, pins, count);
+    zones_sensors_init(&g_sensors, SENSORS);
+
+    for(z=0; z<count; ++z)
+    {
+        internals_t* i = &g_internals[z];
+
+        g_zones.setpoint[z] = 180 + next(&seed)%80;
+        g_zones.hysteresis[z] = 2 + next(&seed)%10;
+        g_zones.mode[z] = (next(&seed)%4) ? (next(&seed)%2 ? tm_auto : tm_cool) : (next(&seed)%2 ? tm_off : tm_heat);
+        g_zones.dew_point_limit[z] = (next(&seed)%2) ? ZONES_GUARD_OFF : 150;
+        g_zones.sensor[z] = next(&seed)%SENSORS;
+
+        memset(i, 0, sizeof(*i));
+        i->setpoint = g_zones.setpoint[z];
+        i->hysteresis = g_zones.hysteresis[z];
+        i->mode = (thermostat_mode_t)g_zones.mode[z];
+        i->dew_point_limit = g_zones.dew_point_limit[z];
+        i->sensor = g_zones.sensor[z];
+    }
+}
+
+/**
+ *  The sensors drift around the setpoints so a share of the zones switch.
+ *  The states are drawn up front so the timed loops only run the ticks.
+ */
+static void drift(uint32_t* seed)
+{
+    uint8_t k;
+    int     n;
+
+    for(n=0; n<SNAPSHOTS; ++n)
+    {
+        g_snapshots[n] = g_sensors;
+        for(k=0; k<SENSORS; ++k)
+        {
+            g_snapshots[n].temperature[k] = 170 + next(seed)%100;
+            g_snapshots[n].dew_point[k] = 100 + next(seed)%100;
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    static const uint16_t counts[] = { 1, 4, 16, 64, 256, 1024, 4096 };
+    unsigned ticks = (argc>1) ? (unsigned)strtoul(argv[1], NULL, 0) : 20000;
+    unsigned c;
+
+    printf("%6s %12s %10s %12s %10s %9s\n", "zones", "soa ns/tick", "ns/zone", "aos ns/tick", "ns/zone", "switched");
+    for(c=0; c<sizeof(counts)/sizeof(counts[0]) && counts[c]<=ZONES_MAX; ++c)
+    {
+        uint16_t count = counts[c];
+        uint32_t seed = 0xBADC0DEu, drift_seed = 0x5EED5u;
+        uint64_t t0, t, t_soa = UINT64_MAX, t_aos = UINT64_MAX, switched = 0, legacy_switched = 0;
+        unsigned k, r;
+
+        zones_sensors_init(&g_sensors, SENSORS);
+        drift(&drift_seed);
+
+        // One clock read per run, not per tick: at a few zones a tick costs
+        // less than reading the clock. The best of REPEATS runs is kept.
+        for(r=0; r<REPEATS; ++r)
+        {
+            setup(count, seed);
+            switched = legacy_switched = 0;
+
+            t0 = bench_now_ns();
+            for(k=0; k<ticks; ++k)
+            {
+                switched += zones_evaluate(&g_zones, &g_snapshots[k%SNAPSHOTS], g_changed);
+            }
+            t = bench_now_ns() - t0;
+            t_soa = (t<t_soa) ? t : t_soa;
+
+            t0 = bench_now_ns();
+            for(k=0; k<ticks; ++k)
+            {
+                const zone_sensors_t* sensors = &g_snapshots[k%SNAPSHOTS];
+                uint16_t              z;
+
+                for(z=0; z<count; ++z)
+                {
+                    internals_t* i = &g_internals[z];
+
+                    i->temperature = sensors->temperature[i->sensor];
+                    i->dew_point = sensors->dew_point[i->sensor];
+                    legacy_switched += legacy_evaluate(i);
+                }
+            }
+            t = bench_now_ns() - t0;
+            t_aos = (t<t_aos) ? t : t_aos;
+        }
+
+        if(switched!=legacy_switched)
+        {
+            fprintf(stderr, "%u zones: %llu switches against %llu for the former logic\n",
+                    count, (unsigned long long)switched, (unsigned long long)legacy_switched);
+            return 1;
+        }
+
+        printf("%6u %12.1f %10.2f %12.1f %10.2f %8.1f%%\n", count,
+               (double)t_soa/ticks, (double)t_soa/ticks/count,
+               (double)t_aos/ticks, (double)t_aos/ticks/count,
+               100.0*switched/ticks/count);
+    }
+    printf("(switched is the share of zone ticks whose output changed)\n");
+
+    return 0;
+}
@@ -6,6 +6,7 @@
  *  @copyright MIT License
  */
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdint.h>
 #include <stddef.h>
 #include <string.h>
@@ -28,9 +29,11 @@
 #include "driver/gpio.h"
 
 #include "comm.h"
+#include "dlog.h"
 
 static mqtt_client    *g_mqtt_client = NULL;
 static comm_on_data_t  g_on_data = NULL;
+static bool            g_test_published = false;  // one test publish per connect, not per subscription
 
 extern const char *MQTT_TAG;
 
@@ -38,7 +41,10 @@ void connected_cb(mqtt_client *client, mqtt_event_data_t *event_data)
 {
     ESP_LOGI(MQTT_TAG, "[APP] connected callback");
     g_mqtt_client = client;
+    g_test_published = false;
     mqtt_subscribe(client, CONFIG_MQTT_TOPIC_DEFAULT, 0);
+    mqtt_subscribe(client, CONFIG_MQTT_TOPIC_DEFAULT "/zone/+", 0);
+    mqtt_subscribe(client, CONFIG_MQTT_TOPIC_DEFAULT "/sensor/+", 0);
     mqtt_publish(client, CONFIG_MQTT_TOPIC_DEFAULT, "BEGIN!", 6, 0, 0);
 }
 void disconnected_cb(mqtt_client *client, mqtt_event_data_t *event_data)
@@ -54,18 +60,22 @@ void reconnect_cb(mqtt_client *client, mqtt_event_data_t *event_data)
 void subscribe_cb(mqtt_client *client, mqtt_event_data_t *event_data)
 {
     g_mqtt_client = client;
-    ESP_LOGI(MQTT_TAG, "[APP] Subscribe ok, test publish msg");
-    mqtt_publish(client, CONFIG_MQTT_TOPIC_DEFAULT, "abcde", 5, 0, 0);
+    ESP_LOGI(MQTT_TAG, "[APP] Subscribe ok");
+    if(!g_test_published)
+    {
+        ESP_LOGI(MQTT_TAG, "[APP] test publish msg");
+        mqtt_publish(client, CONFIG_MQTT_TOPIC_DEFAULT, "abcde", 5, 0, 0);
+        g_test_published = true;
+    }
 }
 
 void publish_cb(mqtt_client *client, mqtt_event_data_t *event_data)
 {
     g_mqtt_client = client;
-    ESP_LOGI(MQTT_TAG, "[APP] publish callback"); 
+    DLOG0(dlog_debug, DLOG_MQTT_PUBLISH);
 }
 void data_cb(mqtt_client *client, mqtt_event_data_t *event_data)
 {
-    ESP_LOGI(MQTT_TAG, "[APP] data callback"); 
     char *topic = NULL;
 
     if(event_data->data_offset == 0) {
@@ -73,18 +83,18 @@ void data_cb(mqtt_client *client, mqtt_event_data_t *event_data)
         topic = malloc(event_data->topic_length + 1);
         memcpy(topic, event_data->topic, event_data->topic_length);
         topic[event_data->topic_length] = 0;
-        ESP_LOGI(MQTT_TAG, "[APP] Publish topic: %s", topic);
+        ESP_LOGD(MQTT_TAG, "[APP] Publish topic: %s", topic);
     }
 
     char *data = malloc(event_data->data_length + 1);
     memcpy(data, event_data->data, event_data->data_length);
     data[event_data->data_length] = 0;
 
-    ESP_LOGI(MQTT_TAG, "[APP] Publish data[%d/%d bytes]",
-             event_data->data_length + event_data->data_offset,
-             event_data->data_total_length);
+    DLOG2(dlog_debug, DLOG_MQTT_DATA,
+          event_data->data_length + event_data->data_offset,
+          event_data->data_total_length);
 
-    ESP_LOGI(MQTT_TAG, "[APP] Publish data[%s]", data);
+    ESP_LOGD(MQTT_TAG, "[APP] Publish data[%s]", data);
     if(g_on_data)
     {
         g_on_data(topic, data);
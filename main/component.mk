@@ -10,7 +10,7 @@ THISDIR:=$(dir $(abspath $(lastword $(MAKEFILE_LIST))))
 DATETIME := $(shell date "+%Y-%b-%d_%H:%M:%S_%Z")
 
 COMPONENT_ADD_INCLUDEDIRS := include
-CFLAGS += -DBUID_TIME=\"$(DATETIME)\" -Wno-error=format=
+CFLAGS += -DBUID_TIME=\"$(DATETIME)\"
 
 ifneq ("$(wildcard $(THISDIR)/include/user_config.local.h)","")
 CFLAGS += -DLOCAL_CONFIG_AVAILABLE
@@ -0,0 +1,145 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      derived.c
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ */
+#include <stdint.h>
+
+#include "derived.h"
+
+#define MAGNUS_B            72172                   // 17.62 in Q12
+#define MAGNUS_C            24312                   // 243.12 celsius degrees, in hundredths
+#define LN_10               9431                    // ln(10) in Q12
+
+#define HI_T_MIN            200                     // first row of g_heat_index, in tenths
+#define HI_T_STEP           20
+#define HI_T_ROWS           16
+#define HI_RH_STEP          100                     // in tenths of %
+#define HI_RH_COLS          11
+
+/**
+ *  ln(rh/100) in Q12 for rh = 1..100 %
+ */
+static const int16_t g_ln_rh[100] = {
+    -18863, -16024, -14363, -13185, -12271, -11524, -10892, -10345,  -9863,  -9431,
+     -9041,  -8685,  -8357,  -8053,  -7771,  -7506,  -7258,  -7024,  -6802,  -6592,
+     -6392,  -6202,  -6020,  -5845,  -5678,  -5518,  -5363,  -5214,  -5070,  -4931,
+     -4797,  -4667,  -4541,  -4419,  -4300,  -4185,  -4072,  -3963,  -3857,  -3753,
+     -3652,  -3553,  -3457,  -3363,  -3271,  -3181,  -3093,  -3006,  -2922,  -2839,
+     -2758,  -2678,  -2600,  -2524,  -2449,  -2375,  -2302,  -2231,  -2161,  -2092,
+     -2025,  -1958,  -1892,  -1828,  -1764,  -1702,  -1640,  -1580,  -1520,  -1461,
+     -1403,  -1346,  -1289,  -1233,  -1178,  -1124,  -1071,  -1018,   -966,   -914,
+      -863,   -813,   -763,   -714,   -666,   -618,   -570,   -524,   -477,   -432,
+      -386,   -342,   -297,   -253,   -210,   -167,   -125,    -83,    -41,      0
+};
+
+/**
+ *  NWS heat index (Rothfusz regression with its low and high humidity
+ *  adjustments) in tenths of celsius degrees, for 20..50 celsius degrees every
+ *  2 degrees and 0..100 % every 10 %.
+ */
+static const int16_t g_heat_index[HI_T_ROWS][HI_RH_COLS] = {
+    {  181,  183,  186,  188,  191,  194,  196,  199,  201,  204,  207 }   // 20
+,   {  203,  205,  208,  210,  213,  216,  218,  221,  223,  226,  229 }   // 22
+,   {  225,  227,  230,  232,  235,  238,  240,  243,  245,  248,  251 }   // 24
+,   {  247,  249,  252,  254,  257,  260,  262,  265,  267,  270,  273 }   // 26
+,   {  258,  264,  267,  271,  277,  284,  294,  307,  321,  340,  364 }   // 28
+,   {  272,  279,  282,  288,  297,  310,  328,  350,  377,  408,  444 }   // 30
+,   {  287,  294,  300,  308,  323,  344,  371,  404,  444,  490,  542 }   // 32
+,   {  301,  311,  320,  333,  354,  384,  422,  468,  522,  584,  655 }   // 34
+,   {  316,  328,  342,  362,  391,  431,  481,  542,  612,  692,  782 }   // 36
+,   {  332,  347,  367,  394,  434,  486,  550,  625,  713,  812,  924 }   // 38
+,   {  347,  367,  394,  431,  483,  548,  626,  719,  825,  945, 1079 }   // 40
+,   {  363,  388,  423,  472,  537,  617,  712,  823,  949, 1090, 1248 }   // 42
+,   {  379,  410,  455,  517,  596,  693,  806,  936, 1084, 1249, 1430 }   // 44
+,   {  393,  432,  490,  566,  662,  776,  909, 1060, 1230, 1419, 1627 }   // 46
+,   {  402,  454,  527,  620,  733,  866, 1020, 1194, 1388, 1602, 1837 }   // 48
+,   {  410,  477,  566,  677,  809,  964, 1140, 1337, 1557, 1798, 2062 }   // 50
+};
+
+static int32_t div_round(int32_t n, int32_t d)
+{
+    if(d<0)
+    {
+        n = -n;
+        d = -d;
+    }
+    return (n<0 ? n - d/2 : n + d/2) / d;
+}
+
+/**
+ *  ln(humidity/1000) in Q12, humidity in tenths of %.
+ *
+ *  Below 10 % the curve is too steep to interpolate, but there the tenths
+ *  are exact table entries: ln(x/1000) = ln(x/100) - ln(10).
+ */
+static int32_t ln_rh(uint16_t humidity)
+{
+    uint16_t i;
+    int32_t  a;
+
+    if(humidity<1)
+        humidity = 1;
+
+    if(humidity<100)
+        return g_ln_rh[humidity-1] - LN_10;
+
+    i = humidity/10;
+    if(i>=100)
+        return 0;
+
+    a = g_ln_rh[i-1];
+    return a + (g_ln_rh[i]-a)*(int32_t)(humidity%10)/10;
+}
+
+/**
+ *  Magnus formula:
+ *
+ *      g  = ln(rh) + b*t/(c+t)
+ *      td = c*g/(b-g)
+ */
+int16_t derived_dew_point(int16_t temperature, uint16_t humidity)
+{
+    int32_t g = ln_rh(humidity) + (int32_t)MAGNUS_B*temperature*10/(MAGNUS_C + temperature*10);
+
+    return (int16_t)div_round(div_round(MAGNUS_C*g, MAGNUS_B-g), 10);
+}
+
+/**
+ *  Below the table the NWS simple formula applies, which is linear:
+ *
+ *      hi = 1.1*t - 3.944 + 0.02611*rh     (celsius degrees and %)
+ *
+ *  Above 50 celsius degrees the last row is used.
+ */
+int16_t derived_heat_index(int16_t temperature, uint16_t humidity)
+{
+    int32_t t, ft, fh, a, b;
+    int     i, j;
+
+    if(humidity>1000)
+        humidity = 1000;
+
+    if(temperature<HI_T_MIN)
+        return (int16_t)div_round(11000*(int32_t)temperature - 394444 + 2611*(int32_t)humidity/10, 10000);
+
+    t  = temperature - HI_T_MIN;
+    i  = t/HI_T_STEP;
+    ft = t%HI_T_STEP;
+    if(i>=HI_T_ROWS-1)
+    {
+        i  = HI_T_ROWS-2;
+        ft = HI_T_STEP;
+    }
+    j  = humidity/HI_RH_STEP;
+    if(j>=HI_RH_COLS-1)
+        j = HI_RH_COLS-2;
+    fh = humidity - j*HI_RH_STEP;
+
+    a = g_heat_index[i][j]*(HI_RH_STEP-fh) + g_heat_index[i][j+1]*fh;
+    b = g_heat_index[i+1][j]*(HI_RH_STEP-fh) + g_heat_index[i+1][j+1]*fh;
+
+    return (int16_t)div_round(a*(HI_T_STEP-ft) + b*ft, HI_T_STEP*HI_RH_STEP);
+}
@@ -0,0 +1,15 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      derived.h
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ */
+#include <stdint.h>
+
+/**
+ *  Metrics derived from a DHT22 reading, integer only. Inputs and results use
+ *  the same units as the sensor: tenths of celsius degrees and tenths of %.
+ */
+int16_t derived_dew_point(int16_t temperature, uint16_t humidity);
+int16_t derived_heat_index(int16_t temperature, uint16_t humidity);
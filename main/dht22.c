@@ -5,6 +5,7 @@
  *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
  *  @copyright MIT License
  */
+#include <string.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -17,6 +18,8 @@
 #include "rom/ets_sys.h"
 
 #include "dht22.h"
+#include "dht22_capture.h"
+#include "dlog.h"
 
 
 #define DHT22_PIN                   GPIO_NUM_21
@@ -24,6 +27,10 @@
 #define DHT22_TIMER_GROUP           TIMER_GROUP_0
 #define DHT22_TIMER                 TIMER_0
 
+#if defined(CONFIG_DHT22_CAPTURE_RING) && CONFIG_DHT22_CAPTURE_RING>0
+#define DHT22_CAPTURE_RING          CONFIG_DHT22_CAPTURE_RING
+#endif
+
 static const gpio_config_t g_gpio_config[] = {
     { 1<<DHT22_PIN, GPIO_MODE_INPUT, GPIO_PULLUP_DISABLE, GPIO_PULLDOWN_DISABLE, GPIO_INTR_ANYEDGE }
 ,   { 0 }
@@ -63,6 +70,15 @@ typedef enum
 static SemaphoreHandle_t g_semaphore   = NULL;
 static QueueHandle_t     g_queue       = NULL;
 static dht22_state_t     g_dht22_state = dht22_idle;
+static dht22_timing_t    g_timing      = { 0 };
+
+#if defined(DHT22_CAPTURE_RING)
+// Failed frames, oldest first from g_capture_head-g_capture_count
+static uint8_t           g_capture[DHT22_CAPTURE_RING][DHT22_CAPTURE_SZ_MAX];
+static uint16_t          g_capture_sz[DHT22_CAPTURE_RING];
+static uint8_t           g_capture_head  = 0;
+static uint8_t           g_capture_count = 0;
+#endif
 
 static void IRAM_ATTR dht22_isr_handler(void* arg)
 {
@@ -87,6 +103,7 @@ static void IRAM_ATTR dht22_isr_handler(void* arg)
         if(pdTRUE!=xQueueSendFromISR(g_queue, &interval, NULL))
         {
             g_dht22_state = dht22_error;
+            DLOG1(dlog_error, DLOG_DHT22_ISR_QUEUE, cnt);
         }
     }
 
@@ -100,6 +117,34 @@ static void IRAM_ATTR dht22_isr_handler(void* arg)
     }
 }
 
+static void capture(const dht22_edge_t* edges, size_t count, dht22_decode_result_t result)
+{
+#if defined(DHT22_CAPTURE_RING)
+    g_capture_sz[g_capture_head] = dht22_capture_write(g_capture[g_capture_head], edges, count, result, NULL);
+    g_capture_head = (g_capture_head+1)%DHT22_CAPTURE_RING;
+    if(g_capture_count<DHT22_CAPTURE_RING)
+        ++g_capture_count;
+#endif
+}
+
+static size_t drain(dht22_edge_t* edges)
+{
+    size_t count = 0;
+
+    for(;;)
+    {
+        dht22_signal_interval_t interval = { 0 };
+
+        if(count==DHT22_EDGES_MAX || pdTRUE!=xQueueReceive(g_queue, &interval, 0))
+            break;
+
+        edges[count].time = (uint32_t)interval.time;
+        edges[count].level = interval.level;
+        ++count;
+    }
+    return count;
+}
+
 bool read(dht22_value_t* value)
 {
     const  TickType_t    wait_for = 100 / portTICK_PERIOD_MS;
@@ -120,6 +165,9 @@ bool read(dht22_value_t* value)
         return true;
     }
 
+    // Invalid until this read gets as far as the bit timing
+    memset(&g_timing, 0, sizeof(g_timing));
+
     // Clear the queue
     if(pdPASS!=xQueueReset(g_queue))
     {
@@ -191,8 +239,9 @@ bool read(dht22_value_t* value)
     // Wait for sensor response
     if(pdTRUE==xSemaphoreTake(g_semaphore, wait_for))
     {
-        uint64_t last = -1;
-        uint8_t v[5] = { 0 };
+        dht22_edge_t          edges[DHT22_EDGES_MAX];
+        size_t                count;
+        dht22_decode_result_t result;
 
         // Enable interrupts
         if(ESP_OK!=gpio_intr_enable(DHT22_PIN))
@@ -201,78 +250,36 @@ bool read(dht22_value_t* value)
             return false;
         }
 
-        for(;;)
+        count = drain(edges);
+        result = dht22_decode(edges, count, value->raw, &g_timing);
+        if(dht22_decode_ok==result)
+        {
+            value->humidity  = value->raw[0] << 8 | value->raw[1];
+            value->temperature  = (0x7F & value->raw[2]) << 8 | value->raw[3];
+            if(value->raw[2] & 0x80)
+                value->temperature = -value->temperature;
+
+            DLOG2(dlog_debug, DLOG_DHT22_VALUE, (uint32_t)value->raw[0]<<24 | value->raw[1]<<16 | value->raw[2]<<8 | value->raw[3], value->raw[4]);
+            last_value = *value;
+            return true;
+        }
+        else if(dht22_decode_checksum==result)
+        {
+            DLOG0(dlog_warn, DLOG_DHT22_CHECKSUM);
+        }
+        else
         {
-            dht22_signal_interval_t interval = { 0 };
-
-            if(pdTRUE == xQueueReceive(g_queue, &interval, 0))
-            {
-                uint64_t delta = (last==-1) ? 0 : (interval.time-last);
-                uint8_t* p;
-
-#if 0
-                printf("dht22_read interval:");
-                printf("  index = %04u", interval.index);
-                printf("  level = %02u", (int)interval.level);
-                printf("  time = 0x%08X%08X", (uint32_t)(interval.time>>32), (uint32_t)(interval.time));
-                printf("  delta = %llu", delta );
-                printf("\n");
-#endif                
-                last = interval.time;
-
-                if (interval.index >2 && (interval.index%2)==1)
-                {
-                    int i = (interval.index-3)/2;
-
-                    p = v+i/8;
-                    *p <<= 1;
-
-                    if(delta>150 && delta<=400)
-                    {
-                    }
-                    else if(delta>400 && delta<900)
-                    {
-                        *p |= 1;
-                    }
-                    else
-                    {
-                      printf("dht22_read error: unexpected interval time!\n");
-                      break;
-                    }
-                }
-            }
-            else
-            {
-                uint16_t sum = v[0] + v[1] + v[2] + v[3];
-                if(v[4]==(0xFF & sum))
-                {
-                    value->raw[0] = v[0];
-                    value->raw[1] = v[1];
-                    value->raw[2] = v[2];
-                    value->raw[3] = v[3];
-                    value->raw[4] = v[4];
-                    value->humidity  = value->raw[0] << 8 | value->raw[1];
-//                    value->humidity /= 10;
-                    value->temperature  = (0x7F & value->raw[2]) << 8 | value->raw[3];
-//                    value->temperature /= 10;
-                    if(value->raw[2] & 0x80)
-                        value->temperature = -value->temperature;
-                }
-                else
-                {
-                    printf("dht22_read error: invalid checksum!\n");
-                    break;
-                }
-
-                printf("dht22_read value = 0x%02X%02X%02X%02X%02X\n", v[0], v[1], v[2], v[3], v[4]);
-                last_value = *value;
-                return true;
-            }
+            DLOG1(dlog_warn, DLOG_DHT22_INTERVAL, result);
         }
+        capture(edges, count, result);
     }
     else
     {
-        printf("dht22_read error: waiting too much for a response!\n");
+        dht22_edge_t edges[DHT22_EDGES_MAX];
+        size_t       count = drain(edges);
+
+        DLOG1(dlog_warn, DLOG_DHT22_TIMEOUT, count);
+        capture(edges, count, dht22_decode_short);
     }
 
     // Enable interrupts
@@ -329,3 +336,44 @@ bool dht22_read(uint16_t* humidity, int16_t* temperature)
     return true;
 }
 
+/**
+ *  Timing of the last read, false when that read failed, checksum failures
+ *  included, so an old margin is never reported as current.
+ */
+bool dht22_read_timing(dht22_timing_t* timing)
+{
+    if(!timing || !g_timing.threshold)
+        return false;
+
+    *timing = g_timing;
+    return true;
+}
+
+/**
+ *  Copies the oldest recorded failed frame, if any, into buff, that must hold
+ *  DHT22_CAPTURE_SZ_MAX bytes, and returns its size. The frame stays in the
+ *  ring until dht22_capture_drop, so it survives a failed publish.
+ */
+size_t dht22_capture_peek(uint8_t* buff)
+{
+#if defined(DHT22_CAPTURE_RING)
+    size_t slot;
+
+    if(!g_capture_count)
+        return 0;
+
+    slot = (g_capture_head + DHT22_CAPTURE_RING - g_capture_count)%DHT22_CAPTURE_RING;
+    memcpy(buff, g_capture[slot], g_capture_sz[slot]);
+    return g_capture_sz[slot];
+#else
+    return 0;
+#endif
+}
+
+void dht22_capture_drop(void)
+{
+#if defined(DHT22_CAPTURE_RING)
+    if(g_capture_count)
+        --g_capture_count;
+#endif
+}
@@ -7,6 +7,11 @@
  */
 #include <stdint.h>
 
+#include "dht22_decode.h"
+
 void dht22_init(void);
 bool dht22_read(uint16_t* humidity, int16_t* temperature);
+bool dht22_read_timing(dht22_timing_t* timing);
+size_t dht22_capture_peek(uint8_t* buff);
+void dht22_capture_drop(void);
 
@@ -0,0 +1,115 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      dht22_capture.c
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "dht22_capture.h"
+
+/**
+ *  Writes the record into buff, that must hold DHT22_CAPTURE_SZ_MAX bytes,
+ *  and returns its size. raw is optional. Edges past DHT22_EDGES_MAX are not
+ *  recorded.
+ */
+size_t dht22_capture_write(uint8_t* buff, const dht22_edge_t* edges, size_t count, uint8_t result, const uint8_t* raw)
+{
+    uint8_t* p = buff + DHT22_CAPTURE_HEADER_SZ;
+    uint32_t first = count ? edges[0].time : 0;
+    size_t   i;
+
+    if(count>DHT22_EDGES_MAX)
+        count = DHT22_EDGES_MAX;
+
+    buff[0] = DHT22_CAPTURE_MAGIC;
+    buff[1] = raw ? DHT22_CAPTURE_RAW : 0;
+    buff[2] = result;
+    buff[3] = (uint8_t)count;
+    buff[4] = (uint8_t)first;
+    buff[5] = (uint8_t)(first>>8);
+    buff[6] = (uint8_t)(first>>16);
+    buff[7] = (uint8_t)(first>>24);
+
+    if(raw)
+    {
+        memcpy(p, raw, 5);
+        p += 5;
+    }
+
+    memset(p, 0, (count+7)/8);
+    for(i=0; i<count; ++i)
+    {
+        if(edges[i].level)
+            p[i/8] |= 1<<(i%8);
+    }
+    p += (count+7)/8;
+
+    for(i=1; i<count; ++i)
+    {
+        uint32_t delta = edges[i].time - edges[i-1].time;
+
+        if(delta>UINT16_MAX)
+            delta = UINT16_MAX;
+
+        *p++ = (uint8_t)delta;
+        *p++ = (uint8_t)(delta>>8);
+    }
+
+    return p - buff;
+}
+
+/**
+ *  Parses the record at buff. Returns its size, so the next one can be read,
+ *  or 0 when there is no valid record there.
+ */
+size_t dht22_capture_read(const uint8_t* buff, size_t sz, dht22_capture_t* capture)
+{
+    const uint8_t* p = buff + DHT22_CAPTURE_HEADER_SZ;
+    size_t         count, need, i;
+    uint32_t       time;
+
+    if(sz<DHT22_CAPTURE_HEADER_SZ || DHT22_CAPTURE_MAGIC!=buff[0])
+        return 0;
+
+    count = buff[3];
+    if(count>DHT22_EDGES_MAX)
+        return 0;
+
+    capture->has_raw = (0!=(buff[1] & DHT22_CAPTURE_RAW));
+    need = DHT22_CAPTURE_HEADER_SZ + (capture->has_raw ? 5 : 0) + (count+7)/8 + (count ? 2*(count-1) : 0);
+    if(sz<need)
+        return 0;
+
+    capture->result = buff[2];
+    capture->count = count;
+    time = (uint32_t)buff[4] | (uint32_t)buff[5]<<8 | (uint32_t)buff[6]<<16 | (uint32_t)buff[7]<<24;
+
+    if(capture->has_raw)
+    {
+        memcpy(capture->raw, p, 5);
+        p += 5;
+    }
+
+    for(i=0; i<count; ++i)
+    {
+        capture->edges[i].level = (p[i/8]>>(i%8)) & 1;
+    }
+    p += (count+7)/8;
+
+    for(i=0; i<count; ++i)
+    {
+        if(i)
+        {
+            time += (uint32_t)p[0] | (uint32_t)p[1]<<8;
+            p += 2;
+        }
+        capture->edges[i].time = time;
+    }
+
+    return need;
+}
@@ -0,0 +1,50 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      dht22_capture.h
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ */
+#ifndef DHT22_CAPTURE_H
+#define DHT22_CAPTURE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "dht22_decode.h"
+
+/**
+ *  Binary record of the raw edges of one DHT22 frame, so a read can be
+ *  replayed through the decoder away from the sensor. Records are self
+ *  delimited and can be concatenated into a corpus file. All multi byte
+ *  fields are little endian.
+ *
+ *      offset  size
+ *      0       1       DHT22_CAPTURE_MAGIC
+ *      1       1       flags, DHT22_CAPTURE_RAW when the expected value follows
+ *      2       1       dht22_decode_result_t seen when recorded
+ *      3       1       edges count, n
+ *      4       4       first edge time, in timer ticks
+ *      8       5       expected raw value, only with DHT22_CAPTURE_RAW
+ *      ..      (n+7)/8 edge levels, bit i%8 of byte i/8 is the level of edge i
+ *      ..      2*(n-1) time from the previous edge, in timer ticks, saturated
+ */
+#define DHT22_CAPTURE_MAGIC     0xD2
+#define DHT22_CAPTURE_RAW       0x01
+#define DHT22_CAPTURE_HEADER_SZ 8
+#define DHT22_CAPTURE_SZ_MAX    (DHT22_CAPTURE_HEADER_SZ + 5 + (DHT22_EDGES_MAX+7)/8 + 2*(DHT22_EDGES_MAX-1))
+
+typedef struct
+{
+    uint8_t         result;
+    bool            has_raw;
+    uint8_t         raw[5];
+    size_t          count;
+    dht22_edge_t    edges[DHT22_EDGES_MAX];
+} dht22_capture_t;
+
+size_t dht22_capture_write(uint8_t* buff, const dht22_edge_t* edges, size_t count, uint8_t result, const uint8_t* raw);
+size_t dht22_capture_read(const uint8_t* buff, size_t sz, dht22_capture_t* capture);
+
+#endif
@@ -0,0 +1,156 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      dht22_decode.c
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "dht22_decode.h"
+
+/**
+ *  The isr normally sees the sensor signal from the end of the response low:
+ *
+ *          response      bit 0              bit 1
+ *       __|  high  |_ low _|  high  |_ low _|  high  |_ ...
+ *         0        1       2        3       4        5
+ *
+ *  so bit b low time is edge[2+2b]-edge[1+2b] and its high time, the one
+ *  that carries the value, is edge[3+2b]-edge[2+2b]. When the falling edge
+ *  that starts the response is also caught, the first edge is a low level
+ *  one and everything moves one place.
+ *
+ *  Instead of fixed windows the time base is calibrated on every read. The
+ *  response high (nominal 80 us) and the mean bit low (50 us) give two
+ *  equations for two unknowns: the ticks per us k, which absorbs clock and
+ *  sensor deviations, and the skew d, which is how late the rising edges are
+ *  seen (cable capacitance, weak pull-up) and that makes highs shorter and
+ *  lows longer by the same amount:
+ *
+ *      response_high = 80*k - d
+ *      low           = 50*k + d        ->  k = (response_high + low)/130
+ *
+ *  The threshold starts half way between a nominal 0 (27 us) and 1 (70 us),
+ *  48.5*k - d, and is then moved to the middle of the two groups of highs
+ *  actually seen, if both are present.
+ */
+#define NOMINAL_SUM_US      130     // response high + bit low
+#define K_MIN               (5*NOMINAL_SUM_US)  // ticks per us, times 130
+#define K_MAX               (20*NOMINAL_SUM_US)
+#define SKEW_MAX_US         20
+
+dht22_decode_result_t dht22_decode(const dht22_edge_t* edges, size_t count, uint8_t raw[5], dht22_timing_t* timing)
+{
+    const dht22_edge_t* f = edges;
+    uint16_t            lows[DHT22_BITS];
+    uint16_t            highs[DHT22_BITS];
+    uint32_t            sum = 0, sum0 = 0, sum1 = 0, n1 = 0;
+    int32_t             k130, skew, threshold;
+    uint32_t            low, response_high, margin = UINT32_MAX;
+    uint8_t             margin_bit = 0;
+    int                 b;
+
+    if(count && 0==edges[0].level)
+    {   // The response falling edge was caught too
+        ++f;
+        --count;
+    }
+
+    if(count<DHT22_FRAME_EDGES)
+        return dht22_decode_short;
+
+    response_high = f[1].time - f[0].time;
+    for(b=0; b<DHT22_BITS; ++b)
+    {
+        uint32_t l = f[2+2*b].time - f[1+2*b].time;
+        uint32_t h = f[3+2*b].time - f[2+2*b].time;
+
+        if(l>UINT16_MAX || h>UINT16_MAX)
+            return dht22_decode_timing;
+
+        lows[b] = (uint16_t)l;
+        highs[b] = (uint16_t)h;
+        sum += l;
+    }
+    low = (sum + DHT22_BITS/2)/DHT22_BITS;
+
+    k130 = (int32_t)(response_high + low);
+    if(k130<K_MIN || k130>K_MAX || response_high>UINT16_MAX)
+        return dht22_decode_preamble;
+
+    skew = (int32_t)low - 50*k130/NOMINAL_SUM_US;
+    if(skew>SKEW_MAX_US*k130/NOMINAL_SUM_US || skew<-SKEW_MAX_US*k130/NOMINAL_SUM_US)
+        return dht22_decode_preamble;
+
+    if(f!=edges)
+    {   // With the response low at hand, check it is 80*k + d as well
+        int32_t expected = 80*k130/NOMINAL_SUM_US + skew;
+        int32_t response_low = (int32_t)(f[0].time - edges[0].time);
+
+        if(response_low-expected>10*k130/NOMINAL_SUM_US || expected-response_low>10*k130/NOMINAL_SUM_US)
+            return dht22_decode_preamble;
+    }
+
+    threshold = 97*k130/(2*NOMINAL_SUM_US) - skew;
+    if(threshold<=0)
+        return dht22_decode_preamble;
+
+    for(b=0; b<DHT22_BITS; ++b)
+    {
+        if(highs[b]>threshold)
+        {
+            sum1 += highs[b];
+            ++n1;
+        }
+        else
+        {
+            sum0 += highs[b];
+        }
+    }
+    if(n1 && n1<DHT22_BITS)
+        threshold = (int32_t)((sum0/(DHT22_BITS-n1) + sum1/n1)/2);
+
+    memset(raw, 0, 5);
+    for(b=0; b<DHT22_BITS; ++b)
+    {
+        uint32_t distance;
+
+        if(lows[b]<low/2 || lows[b]>2*low || highs[b]>2*threshold)
+            return dht22_decode_timing;
+
+        if(highs[b]>threshold)
+        {
+            raw[b/8] |= 0x80>>(b%8);
+            distance = highs[b] - threshold;
+        }
+        else
+        {
+            distance = threshold - highs[b];
+        }
+
+        if(distance<margin)
+        {
+            margin = distance;
+            margin_bit = (uint8_t)b;
+        }
+    }
+
+    if(raw[4]!=(uint8_t)(raw[0] + raw[1] + raw[2] + raw[3]))
+        return dht22_decode_checksum;
+
+    // Only a frame that decoded reports its timing
+    if(timing)
+    {
+        timing->response_high = (uint16_t)response_high;
+        timing->low = (uint16_t)low;
+        timing->skew = (int16_t)skew;
+        timing->threshold = (uint16_t)threshold;
+        timing->margin = (uint16_t)margin;
+        timing->margin_bit = margin_bit;
+    }
+
+    return dht22_decode_ok;
+}
@@ -0,0 +1,58 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      dht22_decode.h
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ */
+#ifndef DHT22_DECODE_H
+#define DHT22_DECODE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define DHT22_TICKS_PER_US      10      // APB 80 MHz / timer divider 8
+#define DHT22_BITS              40
+#define DHT22_FRAME_EDGES       (2 + 2*DHT22_BITS)      // response rising edge .. last bit falling edge
+#define DHT22_EDGES_MAX         (1 + DHT22_FRAME_EDGES + 1)
+
+/**
+ *  One edge of the sensor signal as seen by the isr: the timer value and the
+ *  line level read right after it.
+ */
+typedef struct
+{
+    uint32_t    time;           // in timer ticks
+    uint8_t     level;
+} dht22_edge_t;
+
+/**
+ *  Per read timing, all in timer ticks. Nominal values are 80 us for the
+ *  response high, 50 us for the bit lows, 26..28 us for a 0 and 70 us for a 1.
+ *
+ *  margin is how far the worst bit was from the threshold; as a reference a
+ *  nominal frame has about 21 us of margin. dht22_decode only fills it in
+ *  for a frame that decodes, checksum included.
+ */
+typedef struct
+{
+    uint16_t    response_high;
+    uint16_t    low;            // mean bit low time
+    int16_t     skew;           // how much later than nominal the rising edges are seen
+    uint16_t    threshold;      // bit high times over this are 1s
+    uint16_t    margin;
+    uint8_t     margin_bit;     // bit with the smallest margin, 0 is the msb of raw[0]
+} dht22_timing_t;
+
+typedef enum
+{
+    dht22_decode_ok
+,   dht22_decode_short          // not enough edges
+,   dht22_decode_preamble       // the response does not look like one
+,   dht22_decode_timing         // a bit out of the calibrated window
+,   dht22_decode_checksum
+} dht22_decode_result_t;
+
+dht22_decode_result_t dht22_decode(const dht22_edge_t* edges, size_t count, uint8_t raw[5], dht22_timing_t* timing);
+
+#endif
@@ -0,0 +1,311 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      dlog.c
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(ESP_PLATFORM)
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#endif
+
+#include "dlog.h"
+#include "fmt.h"
+
+#if defined(CONFIG_DLOG_RING_SIZE)
+#define DLOG_RING_SIZE      CONFIG_DLOG_RING_SIZE
+#else
+#define DLOG_RING_SIZE      64
+#endif
+
+#if DLOG_RING_SIZE<2 || (DLOG_RING_SIZE & (DLOG_RING_SIZE-1))
+#error "DLOG_RING_SIZE must be a power of two"
+#endif
+
+/**
+ *  Bounded ring where each slot carries a sequence number (D. Vyukov's
+ *  bounded queue). A writer claims a position by moving g_head with a
+ *  compare and set and publishes the slot by setting its sequence to
+ *  position+1; the reader frees it by setting it to position+size. Nobody
+ *  ever waits: a writer that finds the ring full drops the record and counts
+ *  it, and the reader simply stops at a slot that is not published yet, which
+ *  covers a task interrupted by an isr while filling its slot.
+ *
+ *  The shared words go through the __atomic builtins, acquire/release on the
+ *  sequences, so the ordering also holds when tasks are host threads.
+ */
+typedef struct
+{
+    volatile uint32_t   sequence;
+    dlog_record_t       record;
+} dlog_slot_t;
+
+static dlog_slot_t       g_ring[DLOG_RING_SIZE];
+static volatile uint32_t g_head  = 0;
+static uint32_t          g_tail  = 0;
+static volatile uint32_t g_dropped = 0;
+static volatile uint8_t  g_level = dlog_info;
+static dlog_clock_t      g_clock = NULL;
+
+static const char* const g_formats[] = {
+#define DLOG_FORMAT(id, format) format,
+#include "dlog_formats.h"
+#undef DLOG_FORMAT
+};
+
+#define LOAD(p)         __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define STORE(p, v)     __atomic_store_n(p, v, __ATOMIC_RELEASE)
+
+static bool cas(volatile uint32_t* p, uint32_t expected, uint32_t desired)
+{
+#if defined(ESP_PLATFORM)
+    uint32_t set = desired;
+
+    uxPortCompareSet(p, expected, &set);
+    return set==expected;
+#else
+    return __atomic_compare_exchange_n(p, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#endif
+}
+
+void dlog_init(dlog_clock_t clock)
+{
+    uint32_t i;
+
+    for(i=0; i<DLOG_RING_SIZE; ++i)
+        g_ring[i].sequence = i;
+
+    g_head = g_tail = g_dropped = 0;
+    g_clock = clock;
+}
+
+void dlog_set_level(dlog_level_t level)
+{
+    STORE(&g_level, (uint8_t)level);
+}
+
+dlog_level_t dlog_get_level(void)
+{
+    return (dlog_level_t)LOAD(&g_level);
+}
+
+bool dlog_write(dlog_level_t level, dlog_id_t id, uint8_t argc, const int32_t* args)
+{
+    dlog_slot_t* slot;
+    uint32_t     position;
+
+    if(level>LOAD(&g_level))
+        return true;
+
+    for(;;)
+    {
+        int32_t delta;
+
+        position = LOAD(&g_head);
+        slot = &g_ring[position & (DLOG_RING_SIZE-1)];
+        delta = (int32_t)(LOAD(&slot->sequence) - position);
+
+        if(0==delta)
+        {
+            if(cas(&g_head, position, position+1))
+                break;
+        }
+        else if(delta<0)
+        {   // Full
+            uint32_t dropped;
+
+            do
+            {
+                dropped = LOAD(&g_dropped);
+            } while(!cas(&g_dropped, dropped, dropped+1));
+            return false;
+        }
+    }
+
+    if(argc>DLOG_ARGS_MAX)
+        argc = DLOG_ARGS_MAX;
+
+    slot->record.time = g_clock ? g_clock() : 0;
+    slot->record.id = (uint16_t)id;
+    slot->record.level = (uint8_t)level;
+    slot->record.argc = argc;
+    if(argc)
+        memcpy(slot->record.args, args, argc*sizeof(int32_t));
+
+    STORE(&slot->sequence, position+1);
+    return true;
+}
+
+/**
+ *  Takes the oldest record, if any. Only one task may read.
+ */
+bool dlog_read(dlog_record_t* record)
+{
+    dlog_slot_t* slot = &g_ring[g_tail & (DLOG_RING_SIZE-1)];
+    uint32_t     dropped = LOAD(&g_dropped);
+
+    if(dropped && cas(&g_dropped, dropped, 0))
+    {
+        memset(record, 0, sizeof(*record));
+        record->time = g_clock ? g_clock() : 0;
+        record->id = DLOG_DROPPED;
+        record->level = dlog_warn;
+        record->argc = 1;
+        record->args[0] = (int32_t)dropped;
+        return true;
+    }
+
+    if(LOAD(&slot->sequence)!=g_tail+1)
+        return false;
+
+    *record = slot->record;
+    STORE(&slot->sequence, g_tail + DLOG_RING_SIZE);
+    ++g_tail;
+    return true;
+}
+
+/**
+ *  Little endian: time (4), id (2), level (1), argc (1), argc x int32.
+ */
+size_t dlog_serialize(const dlog_record_t* record, uint8_t* buff)
+{
+    size_t  n = 8;
+    uint8_t i;
+
+    buff[0] = (uint8_t)record->time;
+    buff[1] = (uint8_t)(record->time>>8);
+    buff[2] = (uint8_t)(record->time>>16);
+    buff[3] = (uint8_t)(record->time>>24);
+    buff[4] = (uint8_t)record->id;
+    buff[5] = (uint8_t)(record->id>>8);
+    buff[6] = record->level;
+    buff[7] = record->argc;
+
+    for(i=0; i<record->argc; ++i)
+    {
+        uint32_t a = (uint32_t)record->args[i];
+
+        buff[n++] = (uint8_t)a;
+        buff[n++] = (uint8_t)(a>>8);
+        buff[n++] = (uint8_t)(a>>16);
+        buff[n++] = (uint8_t)(a>>24);
+    }
+    return n;
+}
+
+/**
+ *  Returns the size of the record at buff, or 0 when there is no valid one.
+ */
+size_t dlog_deserialize(const uint8_t* buff, size_t sz, dlog_record_t* record)
+{
+    size_t  n = 8;
+    uint8_t i;
+
+    if(sz<8 || buff[7]>DLOG_ARGS_MAX || sz<8u + 4u*buff[7])
+        return 0;
+
+    memset(record, 0, sizeof(*record));
+    record->time = (uint32_t)buff[0] | (uint32_t)buff[1]<<8 | (uint32_t)buff[2]<<16 | (uint32_t)buff[3]<<24;
+    record->id = (uint16_t)(buff[4] | buff[5]<<8);
+    record->level = buff[6];
+    record->argc = buff[7];
+
+    for(i=0; i<record->argc; ++i, n+=4)
+    {
+        record->args[i] = (int32_t)((uint32_t)buff[n] | (uint32_t)buff[n+1]<<8 | (uint32_t)buff[n+2]<<16 | (uint32_t)buff[n+3]<<24);
+    }
+    return n;
+}
+
+const char* dlog_level_name(uint8_t level)
+{
+    return (dlog_error==level ? "E" :
+            dlog_warn==level ? "W" :
+            dlog_info==level ? "I" :
+            dlog_debug==level ? "D" : "?" );
+}
+
+/**
+ *  Formats the message of a record into buff, truncated to sz-1 characters.
+ *  Conversions are %d, %u, %X and %t (a value in tenths, 215 -> 21.5), with
+ *  an optional zero padded width, i.e. %02X, and %%. Missing arguments are 0.
+ */
+size_t dlog_format(char* buff, size_t sz, const dlog_record_t* record)
+{
+    const char* f;
+    size_t      n = 0;
+    uint8_t     arg = 0;
+
+    if(!sz)
+        return 0;
+
+    if(record->id>=DLOG_FORMATS)
+    {
+        char s[FMT_UINT_LEN_MAX+1];
+
+        fmt_uint(s, record->id);
+        for(f="unknown log id "; *f && n+1<sz; ++f)
+            buff[n++] = *f;
+        for(f=s; *f && n+1<sz; ++f)
+            buff[n++] = *f;
+        buff[n] = 0;
+        return n;
+    }
+
+    for(f=g_formats[record->id]; *f && n+1<sz; ++f)
+    {
+        char    s[FMT_TENTHS_LEN_MAX+1];
+        char*   p = s;
+        uint8_t width = 0;
+        int32_t value;
+
+        if('%'!=*f)
+        {
+            buff[n++] = *f;
+            continue;
+        }
+
+        ++f;
+        if('%'==*f)
+        {
+            buff[n++] = '%';
+            continue;
+        }
+
+        while(*f>='0' && *f<='9')
+            width = width*10 + (uint8_t)(*f++ - '0');
+        if(width>FMT_HEX_LEN_MAX)
+            width = FMT_HEX_LEN_MAX;
+
+        value = (arg<record->argc) ? record->args[arg] : 0;
+        ++arg;
+
+        switch(*f)
+        {
+            case 'd': fmt_int_pad(s, value, width); break;
+            case 'u': fmt_uint_pad(s, (uint32_t)value, width); break;
+            case 'X': fmt_hex(s, (uint32_t)value, width); break;
+            case 't': fmt_tenths(s, value); break;
+            default:
+            {   // Unknown conversion, keep it as is
+                s[0] = '%';
+                s[1] = *f;
+                s[2] = 0;
+            } break;
+        }
+        if(!*f)
+            break;
+
+        while(*p && n+1<sz)
+            buff[n++] = *p++;
+    }
+    buff[n] = 0;
+
+    return n;
+}
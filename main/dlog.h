@@ -0,0 +1,68 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      dlog.h
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ */
+#ifndef DLOG_H
+#define DLOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ *  Deferred logging: the hot paths only store a format id and a few integers
+ *  into a lock-free ring, which is cheap enough for tasks and isrs. A low
+ *  priority task, or the host tool, does the formatting later.
+ *
+ *  Any number of writers, one reader.
+ */
+#define DLOG_ARGS_MAX       4
+#define DLOG_RECORD_SZ_MAX  (8 + 4*DLOG_ARGS_MAX)   // serialized
+
+typedef enum
+{
+    dlog_error
+,   dlog_warn
+,   dlog_info
+,   dlog_debug
+} dlog_level_t;
+
+typedef enum
+{
+#define DLOG_FORMAT(id, format) id,
+#include "dlog_formats.h"
+#undef DLOG_FORMAT
+    DLOG_FORMATS
+} dlog_id_t;
+
+typedef struct
+{
+    uint32_t    time;           // in ms
+    uint16_t    id;
+    uint8_t     level;
+    uint8_t     argc;
+    int32_t     args[DLOG_ARGS_MAX];
+} dlog_record_t;
+
+typedef uint32_t (*dlog_clock_t)(void);
+
+#define DLOG0(level, id)            dlog_write(level, id, 0, NULL)
+#define DLOG1(level, id, a)         dlog_write(level, id, 1, (const int32_t[]){ (int32_t)(a) })
+#define DLOG2(level, id, a, b)      dlog_write(level, id, 2, (const int32_t[]){ (int32_t)(a), (int32_t)(b) })
+#define DLOG3(level, id, a, b, c)   dlog_write(level, id, 3, (const int32_t[]){ (int32_t)(a), (int32_t)(b), (int32_t)(c) })
+
+void         dlog_init(dlog_clock_t clock);
+void         dlog_set_level(dlog_level_t level);
+dlog_level_t dlog_get_level(void);
+bool         dlog_write(dlog_level_t level, dlog_id_t id, uint8_t argc, const int32_t* args);
+bool         dlog_read(dlog_record_t* record);
+
+size_t       dlog_serialize(const dlog_record_t* record, uint8_t* buff);
+size_t       dlog_deserialize(const uint8_t* buff, size_t sz, dlog_record_t* record);
+size_t       dlog_format(char* buff, size_t sz, const dlog_record_t* record);
+const char*  dlog_level_name(uint8_t level);
+
+#endif
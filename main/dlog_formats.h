@@ -0,0 +1,38 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      dlog_formats.h
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ *
+ *  Deferred log messages, DLOG_FORMAT(id, format). The position in this list
+ *  is the id that goes over the wire, so only append to it.
+ *
+ *  Formats take up to DLOG_ARGS_MAX integer arguments, see dlog_format for
+ *  the conversions. Arguments added later go last, so records from older
+ *  firmware still format (the missing ones read as 0). This file is included
+ *  more than once on purpose.
+ */
+DLOG_FORMAT(DLOG_DROPPED,                   "%u log records dropped")
+DLOG_FORMAT(DLOG_LEVEL,                     "log level set to %u")
+DLOG_FORMAT(DLOG_DHT22_READ,                "DHT22 read successfully! humidity = %t%%, temperature = %t degrees")
+DLOG_FORMAT(DLOG_DHT22_VALUE,               "dht22_read value = 0x%08X%02X")
+DLOG_FORMAT(DLOG_DHT22_CHECKSUM,            "dht22_read error: invalid checksum!")
+DLOG_FORMAT(DLOG_DHT22_INTERVAL,            "dht22_read error: unexpected interval time! (decode result %u)")
+DLOG_FORMAT(DLOG_DHT22_TIMEOUT,             "dht22_read error: waiting too much for a response! (%u edges)")
+DLOG_FORMAT(DLOG_DHT22_ISR_QUEUE,           "dht22 isr error: cannot queue edge %u")
+DLOG_FORMAT(DLOG_GPIO_SET_LEVEL,            "thermostat_process error: gpio_set_level fail! (zone %u)")
+DLOG_FORMAT(DLOG_BATCH_INVALID,             "ERROR invalid command %d in batch (zone %u)")
+DLOG_FORMAT(DLOG_SETPOINT,                  "New setpoint is set at %t celsius degrees (zone %u)")
+DLOG_FORMAT(DLOG_SETPOINT_ERROR,            "ERROR trying to update the setpoint (zone %u)")
+DLOG_FORMAT(DLOG_HYSTERESIS,                "New hysteresis is set at %t celsius degrees (zone %u)")
+DLOG_FORMAT(DLOG_HYSTERESIS_ERROR,          "ERROR trying to update the hysteresis (zone %u)")
+DLOG_FORMAT(DLOG_DEW_POINT_LIMIT,           "New dew point limit is set at %t celsius degrees (zone %u)")
+DLOG_FORMAT(DLOG_DEW_POINT_LIMIT_ERROR,     "ERROR trying to update the dew point limit (zone %u)")
+DLOG_FORMAT(DLOG_MQTT_PUBLISH,              "[APP] publish callback")
+DLOG_FORMAT(DLOG_MQTT_DATA,                 "[APP] data callback, data[%u/%u bytes]")
+DLOG_FORMAT(DLOG_ZONES,                     "%u zones, %u sensors")
+DLOG_FORMAT(DLOG_BINDING,                   "zone %u follows sensor %u")
+DLOG_FORMAT(DLOG_BINDING_ERROR,             "ERROR trying to bind zone %u")
+DLOG_FORMAT(DLOG_SENSOR,                    "sensor %u: humidity = %t%%, temperature = %t degrees")
+DLOG_FORMAT(DLOG_LOG_STACK,                 "log task stack high water mark %u of %u bytes")
@@ -0,0 +1,148 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      fmt.c
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ */
+#include <stdint.h>
+#include <stddef.h>
+
+#include "fmt.h"
+
+static uint8_t digits(uint32_t value)
+{
+    uint8_t n = 1;
+
+    while(value>=10)
+    {
+        value /= 10;
+        ++n;
+    }
+    return n;
+}
+
+/**
+ *  Writes value with at least width digits, left padded with zeros.
+ */
+static size_t put_uint(char* buff, uint32_t value, uint8_t width)
+{
+    uint8_t n = digits(value);
+    char*   p;
+
+    if(n<width)
+        n = width;
+
+    p = buff + n;
+    *p = 0;
+    do
+    {
+        *--p = '0' + (char)(value%10);
+        value /= 10;
+    } while(p>buff);
+
+    return n;
+}
+
+static size_t put_int(char* buff, int32_t value, uint8_t width)
+{
+    if(value<0)
+    {
+        buff[0] = '-';
+        return 1 + put_uint(buff+1, 0u - (uint32_t)value, width);
+    }
+    return put_uint(buff, (uint32_t)value, width);
+}
+
+size_t fmt_uint(char* buff, uint32_t value)
+{
+    return put_uint(buff, value, 0);
+}
+
+size_t fmt_uint_pad(char* buff, uint32_t value, uint8_t width)
+{
+    return put_uint(buff, value, width);
+}
+
+size_t fmt_int(char* buff, int32_t value)
+{
+    return put_int(buff, value, 0);
+}
+
+/**
+ *  Same as fmt_int but with at least width digits; the sign, if any, is not
+ *  counted, so the buffer needs room for width+2 characters.
+ */
+size_t fmt_int_pad(char* buff, int32_t value, uint8_t width)
+{
+    return put_int(buff, value, width);
+}
+
+/**
+ *  value is in tenths, i.e. 215 -> "21.5", -5 -> "-0.5"
+ */
+size_t fmt_tenths(char* buff, int32_t value)
+{
+    uint32_t u = (value<0) ? 0u - (uint32_t)value : (uint32_t)value;
+    size_t   n = 0;
+
+    if(value<0)
+        buff[n++] = '-';
+
+    n += put_uint(buff+n, u/10, 0);
+    buff[n++] = '.';
+    buff[n++] = '0' + (char)(u%10);
+    buff[n] = 0;
+
+    return n;
+}
+
+/**
+ *  Upper case hexadecimal with at least width digits, left padded with zeros.
+ */
+size_t fmt_hex(char* buff, uint32_t value, uint8_t width)
+{
+    uint8_t n = 1;
+    char*   p;
+
+    while(n<8 && (value>>(4*n)))
+        ++n;
+    if(n<width)
+        n = width;
+
+    p = buff + n;
+    *p = 0;
+    do
+    {
+        *--p = "0123456789ABCDEF"[value & 0xF];
+        value >>= 4;
+    } while(p>buff);
+
+    return n;
+}
+
+size_t fmt_str(char* buff, const char* s)
+{
+    size_t n = 0;
+
+    while(s[n])
+    {
+        buff[n] = s[n];
+        ++n;
+    }
+    buff[n] = 0;
+
+    return n;
+}
+
+/**
+ *  "<OPCODE>=<value>", the opcode is always sent in upper case.
+ *  buff must hold at least FMT_VALUE_SZ bytes.
+ */
+size_t fmt_value(char* buff, char opcode, int32_t value)
+{
+    buff[0] = opcode & 0xDF;
+    buff[1] = '=';
+
+    return 2 + fmt_int(buff+2, value);
+}
@@ -0,0 +1,35 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      fmt.h
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ */
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ *  Small, allocation-free replacements for the sprintf calls on the telemetry
+ *  paths. Every writer stores its text at buff, appends a terminating zero and
+ *  returns the number of characters written (without the terminator), so the
+ *  callers can chain them and hand the length straight to comm_send.
+ *
+ *  The caller owns the buffer; the *_LEN_MAX values below are the worst case
+ *  lengths (without the terminator) so buffers can be sized at compile time.
+ */
+#define FMT_UINT_LEN_MAX    10      // "4294967295"
+#define FMT_INT_LEN_MAX     11      // "-2147483648"
+#define FMT_TENTHS_LEN_MAX  12      // "-214748364.8"
+#define FMT_HEX_LEN_MAX     8       // "FFFFFFFF"
+
+// "<opcode>=<int>" frame, as published by send_value
+#define FMT_VALUE_SZ        (2 + FMT_INT_LEN_MAX + 1)
+
+size_t fmt_uint(char* buff, uint32_t value);
+size_t fmt_uint_pad(char* buff, uint32_t value, uint8_t width);
+size_t fmt_int(char* buff, int32_t value);
+size_t fmt_int_pad(char* buff, int32_t value, uint8_t width);
+size_t fmt_tenths(char* buff, int32_t value);
+size_t fmt_hex(char* buff, uint32_t value, uint8_t width);
+size_t fmt_str(char* buff, const char* s);
+size_t fmt_value(char* buff, char opcode, int32_t value);
@@ -6,7 +6,9 @@
  *  @copyright MIT License
  */
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <stddef.h>
 #include <string.h>
 
@@ -19,46 +21,72 @@
 #include "freertos/queue.h"
 
 #include "esp_log.h"
+#include "esp_system.h"
 #include "driver/gpio.h"
 
 #include "comm.h"
 #include "dht22.h"
-
-#define PIN_OUTPUT  GPIO_NUM_23
-
-typedef enum
-{
-    tm_off
-,   tm_auto
-,   tm_heat
-} thermostat_mode_t;
+#include "dht22_capture.h"
+#include "fmt.h"
+#include "stats.h"
+#include "derived.h"
+#include "dlog.h"
+#include "zones.h"
+
+#define PIN_OUTPUT      GPIO_NUM_23     // relay of zone 0 when CONFIG_THERMOSTAT_ZONE_PINS is unusable
+#define MODE_FRAME_SZ   (2 + 4 + 1)     // "M=" + longest mode name + '\0'
+#define BATCH_ACK_SZ    (4*FMT_VALUE_SZ + MODE_FRAME_SZ)
+
+#define TOPIC_ZONE      CONFIG_MQTT_TOPIC_DEFAULT "/zone/"
+#define TOPIC_SENSOR    CONFIG_MQTT_TOPIC_DEFAULT "/sensor/"
+#define TOPIC_STATE     "/state"
+#define TOPIC_STATE_SZ  (sizeof(TOPIC_ZONE) + FMT_UINT_LEN_MAX + sizeof(TOPIC_STATE))
+
+#define CMD_LEN_MAX         10
+#define CMD_BATCH_LEN_MAX   48
+
+#define LOG_TASK_PERIOD_MS  200
+#if defined(CONFIG_DLOG_PUBLISH)
+#define LOG_TASK_STACK_SZ   4096    // frame buffer, printf fallback and the mqtt_publish path
+#else
+#define LOG_TASK_STACK_SZ   3072    // line buffer and newlib printf
+#endif
+#define LOG_LINE_SZ         96
+#define LOG_FRAME_SZ        (16*DLOG_RECORD_SZ_MAX)
+
+#if defined(CONFIG_THERMOSTAT_RAW_TELEMETRY)
+#define RAW_TELEMETRY   true
+#else
+#define RAW_TELEMETRY   false
+#endif
 
 typedef struct
 {
-    int16_t             setpoint;       // in tenths of celsius degrees
-    int16_t             hysteresis;     // in tenths of celsius degrees
-    int16_t             temperature;    // in tenths of celsius degrees
-    thermostat_mode_t   mode;           
-    bool                output;
+    bool                has_setpoint;
+    bool                has_hysteresis;
+    bool                has_mode;
+    bool                has_dew_point_limit;
+    int16_t             setpoint;
+    int16_t             hysteresis;
+    thermostat_mode_t   mode;
+    int16_t             dew_point_limit;
+} thermostat_batch_t;
 
-    uint16_t            humidity;       // just to report..
+const char *MQTT_TAG = "THERMOSTAT";
 
-} thermostat_internals_t;
 
-const char *MQTT_TAG = "THERMOSTAT";
+stats_window_t g_stats_window = { 0 };
 
-const gpio_config_t g_gpio_config[] = {
-    { 1<<PIN_OUTPUT, GPIO_MODE_OUTPUT|GPIO_MODE_INPUT, GPIO_PULLUP_DISABLE, GPIO_PULLDOWN_DISABLE, GPIO_INTR_DISABLE }
-,   { 0 }
-};
+portMUX_TYPE g_thermostat_mux = portMUX_INITIALIZER_UNLOCKED;
 
-thermostat_internals_t g_thermostat_internals = {
-    .setpoint = 250
-,   .hysteresis = 5
-,   .temperature = 250
-,   .mode = tm_auto
-,   .output = false 
-};
+/**
+ *  Zone 0 is the one the default topic has always controlled; zone n>0 takes
+ *  commands on <default topic>/zone/<n> and answers on .../zone/<n>/state.
+ *  Sensor 0 is the on-board DHT22, the others are fed on
+ *  <default topic>/sensor/<n> with t=<tenths> and h=<tenths>.
+ */
+zone_table_t   g_zones;
+zone_sensors_t g_sensors;
 
 bool temperature_parse(const char* s, int16_t* temperature)
 { 
@@ -72,63 +100,302 @@ bool temperature_parse(const char* s, int16_t* temperature)
     return true;
 }
 
+const char* mode_name(thermostat_mode_t mode)
+{
+    return (tm_off==mode ? "off" : 
+            tm_auto==mode ? "auto" :
+            tm_heat==mode ? "heat" :
+            tm_cool==mode ? "cool" : "err" );
+}
+
+/**
+ *  Where the state of a zone is published, the default topic for zone 0.
+ *  buff must hold TOPIC_STATE_SZ bytes.
+ */
+const char* zone_topic(char* buff, uint16_t zone)
+{
+    size_t n;
+
+    if(!zone)
+        return CONFIG_MQTT_TOPIC_DEFAULT;
+
+    n = fmt_str(buff, TOPIC_ZONE);
+    n += fmt_uint(buff+n, zone);
+    fmt_str(buff+n, TOPIC_STATE);
+    return buff;
+}
+
 void send_value(char opcode, int value)
 {
-    char s[15] = { 0 };
+    char   s[FMT_VALUE_SZ];
+    size_t n = fmt_value(s, opcode, value);
 
-    sprintf(s, "%c=%d", opcode&0xDF, value); 
-    comm_send_string(CONFIG_MQTT_TOPIC_DEFAULT, s); 
+    comm_send(CONFIG_MQTT_TOPIC_DEFAULT, s, n); 
 }
 
-void send_mode(void)
+void send_zone_value(uint16_t zone, char opcode, int value)
 {
-    char s[10] = { 0 };
-    
-    sprintf(s, "M=%s", (tm_off==g_thermostat_internals.mode ? "off" : 
-                        tm_auto==g_thermostat_internals.mode ? "auto" :
-                        tm_heat==g_thermostat_internals.mode ? "heat" : "err" ));
-    comm_send_string(CONFIG_MQTT_TOPIC_DEFAULT, s); 
+    char   topic[TOPIC_STATE_SZ];
+    char   s[FMT_VALUE_SZ];
+    size_t n = fmt_value(s, opcode, value);
+
+    comm_send(zone_topic(topic, zone), s, n); 
 }
 
+void send_stats(const stats_window_t* w)
+{
+    char   s[STATS_FRAME_SZ];
+    size_t n = stats_format(s, w);
+
+    comm_send(CONFIG_MQTT_TOPIC_DEFAULT, s, n); 
+}
+
+void send_capture(void)
+{
+    uint8_t s[DHT22_CAPTURE_SZ_MAX];
+    size_t  n = dht22_capture_peek(s);
+
+    if(n && comm_send(CONFIG_MQTT_TOPIC_DEFAULT "/capture", (const char*)s, n))
+    {   // Otherwise it is sent again on the next cycle
+        dht22_capture_drop();
+    }
+}
+
+void send_mode(uint16_t zone)
+{
+    char   topic[TOPIC_STATE_SZ];
+    char   s[MODE_FRAME_SZ] = "M=";
+    size_t n = 2 + fmt_str(s+2, mode_name(g_zones.mode[zone]));
 
+    comm_send(zone_topic(topic, zone), s, n); 
+}
+
+void drive(uint16_t zone)
+{
+    if(ESP_OK!=gpio_set_level(g_zones.pin[zone], g_zones.output[zone]))
+    { 
+        DLOG1(dlog_error, DLOG_GPIO_SET_LEVEL, zone);
+    }
+}
 
 /**
- *      T = off
- *      ---------------- setpoint+hysteresis
- *      
- *      ================ setpoint
- *      
- *      ---------------- setpoint-hysteresis
- *      T = on
+ *  One control tick over every zone, see zones_evaluate. Both the MQTT and
+ *  the main task run it, hence the lock. Only the relays whose output changed
+ *  are driven; their indexes are left in changed[].
  */
-void thermostat_process(thermostat_internals_t* i)
+uint16_t thermostat_evaluate(uint16_t* changed)
 { 
-    if(i)
+    uint16_t n;
+    uint16_t k;
+
+    portENTER_CRITICAL(&g_thermostat_mux);
+    n = zones_evaluate(&g_zones, &g_sensors, changed);
+    portEXIT_CRITICAL(&g_thermostat_mux);
+
+    for(k=0; k<n; ++k)
     {
-        switch(i->mode)
-        { 
-            case tm_off: 
-            case tm_heat: 
-            {
-                i->output = (tm_heat==i->mode);
-            } break;
-            case tm_auto:
+        drive(changed[k]);
+    }
+    return n;
+}
+
+/**
+ *  Evaluates and publishes O= for every zone that changed, and for zone
+ *  anyway when it is a valid one (pass -1 for none).
+ */
+void thermostat_process(int zone)
+{ 
+    uint16_t changed[ZONES_MAX];
+    uint16_t n = thermostat_evaluate(changed);
+    uint16_t k;
+
+    for(k=0; k<n; ++k)
+    {
+        send_zone_value(changed[k], 'O', g_zones.output[changed[k]]); 
+        if(changed[k]==zone)
+            zone = -1;
+    }
+
+    if(zone>=0 && zone<g_zones.count)
+    {
+        send_zone_value(zone, 'O', g_zones.output[zone]); 
+    }
+}
+
+/**
+ *  Strict version of temperature_parse for batches: an optional sign and
+ *  digits only, within the int16_t range.
+ */
+bool value_parse(const char* s, size_t len, int16_t* value)
+{
+    int32_t v = 0;
+    bool    negative = false;
+    size_t  k = 0;
+
+    if(k<len && (s[k]=='-' || s[k]=='+'))
+    {
+        negative = (s[k]=='-');
+        ++k;
+    }
+
+    if(k==len)
+        return false;
+
+    for(; k<len; ++k)
+    {
+        if(s[k]<'0' || s[k]>'9')
+            return false;
+
+        v = 10*v + (s[k]-'0');
+        if(v>(negative ? -INT16_MIN : INT16_MAX))
+            return false;
+    }
+
+    *value = (int16_t)(negative ? -v : v);
+    return true;
+}
+
+bool mode_parse(const char* s, size_t len, thermostat_mode_t* mode)
+{
+    thermostat_mode_t m;
+
+    for(m=tm_off; m<=tm_cool; ++m)
+    {
+        const char* name = mode_name(m);
+
+        if(len==strlen(name) && 0==strncmp(s, name, len))
+        {
+            *mode = m;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ *  Validates a whole batch, i.e. "s=215;d=5;m=auto", into b. Each setting can
+ *  appear once and a trailing ';' is accepted.
+ *
+ *  Returns 0 when the batch is valid, otherwise the position (1 based) of the
+ *  first offending command.
+ */
+int batch_parse(const char* buff, thermostat_batch_t* b)
+{
+    const char* p = buff;
+    int         position = 0;
+
+    memset(b, 0, sizeof(*b));
+
+    while(*p)
+    {
+        const char* end = strchr(p, ';');
+        size_t      len;
+        bool        ok = false;
+
+        if(!end)
+            end = p + strlen(p);
+
+        len = end - p;
+        ++position;
+
+        if(len>2 && '='==p[1])
+        {
+            switch(p[0])
             {
-                int16_t threshold = i->setpoint + (i->output ? i->hysteresis : - i->hysteresis);
-                
-                i->output = (i->temperature<threshold);
+                case 's':
+                {
+                    ok = !b->has_setpoint && value_parse(p+2, len-2, &b->setpoint);
+                    b->has_setpoint = true;
+                } break;
+                case 'd':
+                {
+                    ok = !b->has_hysteresis && value_parse(p+2, len-2, &b->hysteresis) && b->hysteresis>=0;
+                    b->has_hysteresis = true;
+                } break;
+                case 'm':
+                {
+                    ok = !b->has_mode && mode_parse(p+2, len-2, &b->mode);
+                    b->has_mode = true;
+                } break;
+                case 'g':
+                {
+                    ok = !b->has_dew_point_limit && value_parse(p+2, len-2, &b->dew_point_limit);
+                    b->has_dew_point_limit = true;
+                } break;
             }
         }
-        send_value('O', i->output ? 1 : 0); 
 
-        if(ESP_OK!=gpio_set_level(PIN_OUTPUT, i->output))
-        { 
-            printf("thermostat_process error: gpio_set_level fail!\n");
-        }
-    } 
+        if(!ok)
+            return position;
+
+        p = *end ? end+1 : end;
+    }
+
+    return position ? 0 : 1;
+}
+
+/**
+ *  S=<setpoint>;D=<hysteresis>;M=<mode>;G=<dew point limit>;O=<output>, the
+ *  state after a batch.
+ */
+void send_batch_ack(uint16_t zone)
+{
+    char   topic[TOPIC_STATE_SZ];
+    char   s[BATCH_ACK_SZ];
+    size_t n = 0;
+
+    n += fmt_value(s+n, 'S', g_zones.setpoint[zone]);
+    s[n++] = ';';
+    n += fmt_value(s+n, 'D', g_zones.hysteresis[zone]);
+    s[n++] = ';';
+    n += fmt_str(s+n, "M=");
+    n += fmt_str(s+n, mode_name(g_zones.mode[zone]));
+    s[n++] = ';';
+    n += fmt_value(s+n, 'G', g_zones.dew_point_limit[zone]);
+    s[n++] = ';';
+    n += fmt_value(s+n, 'O', g_zones.output[zone]);
+
+    comm_send(zone_topic(topic, zone), s, n); 
+}
+
+/**
+ *  All the settings in a batch are checked before touching anything, then
+ *  applied together and followed by one control evaluation and one ack frame.
+ *  An invalid batch leaves the thermostat untouched and is answered with
+ *  E=<position of the first offending command>, or E=0 when the whole batch
+ *  is longer than CMD_BATCH_LEN_MAX.
+ */
+void batch_process(uint16_t zone, const char* buff)
+{
+    thermostat_batch_t b;
+    int                position = batch_parse(buff, &b);
+    uint16_t           changed[ZONES_MAX];
+    uint16_t           n, k;
+
+    if(position)
+    {
+        DLOG2(dlog_warn, DLOG_BATCH_INVALID, position, zone);
+        send_zone_value(zone, 'E', position);
+        return;
+    }
+
+    portENTER_CRITICAL(&g_thermostat_mux);
+    if(b.has_setpoint)        g_zones.setpoint[zone] = b.setpoint;
+    if(b.has_hysteresis)      g_zones.hysteresis[zone] = b.hysteresis;
+    if(b.has_mode)            g_zones.mode[zone] = b.mode;
+    if(b.has_dew_point_limit) g_zones.dew_point_limit[zone] = b.dew_point_limit;
+    portEXIT_CRITICAL(&g_thermostat_mux);
+
+    n = thermostat_evaluate(changed);
+    for(k=0; k<n; ++k)
+    {   // The batch zone reports its output in the ack
+        if(changed[k]!=zone)
+            send_zone_value(changed[k], 'O', g_zones.output[changed[k]]); 
+    }
+    send_batch_ack(zone);
 }
 
-bool cmd_process(const char*buff, char opcode, int value)
+bool cmd_process(uint16_t zone, const char*buff, char opcode, int value)
 {
     char s[15] = { 0 };
 
@@ -140,106 +407,416 @@ bool cmd_process(const char*buff, char opcode, int value)
 
         if(0==strcmp(buff, s))
         { 
-            send_value(opcode, value);
+            send_zone_value(zone, opcode, value);
             return true;
         } 
     } 
     return false;
 }
 
-void comm_on_data(const char* topic, const char* buff)
+/**
+ *  Parses "<prefix><index>", with index below limit.
+ */
+bool topic_index(const char* topic, const char* prefix, uint16_t limit, uint16_t* index)
+{
+    size_t   len = strlen(prefix);
+    uint32_t v = 0;
+    const char* p;
+
+    if(strncmp(topic, prefix, len) || !topic[len])
+        return false;
+
+    for(p=topic+len; *p; ++p)
+    {
+        if(*p<'0' || *p>'9')
+            return false;
+
+        v = 10*v + (*p-'0');
+        if(v>=limit)
+            return false;
+    }
+
+    *index = (uint16_t)v;
+    return true;
+}
+
+void zone_on_data(uint16_t zone, const char* buff)
 { 
-    if(0==strcmp(topic, CONFIG_MQTT_TOPIC_DEFAULT) && buff && strlen(buff)<=10)
+    uint8_t sensor = g_zones.sensor[zone];
+
+    if(buff[0]>='A' && buff[0]<='Z')
+    {   // Our own frames, echoed back on the subscribed topic
+        return;
+    }
+
+    if(strchr(buff, ';'))
+    {
+        if(strlen(buff)<=CMD_BATCH_LEN_MAX)
+        {
+            batch_process(zone, buff);
+        }
+        else
+        {
+            DLOG2(dlog_warn, DLOG_BATCH_INVALID, 0, zone);
+            send_zone_value(zone, 'E', 0);
+        }
+    }
+    else if(strlen(buff)<=CMD_LEN_MAX)
     {
         if(0==strncmp(buff, "s=",2))
         {
-            if(temperature_parse(buff+2, &g_thermostat_internals.setpoint))
+            if(temperature_parse(buff+2, &g_zones.setpoint[zone]))
             {
-                printf("New setpoint is set at %d celsius degrees\n", g_thermostat_internals.setpoint);
+                DLOG2(dlog_info, DLOG_SETPOINT, g_zones.setpoint[zone], zone);
             }
             else
             {
-                printf("ERROR trying to update the setpoint [%s]\n", buff); 
+                DLOG1(dlog_warn, DLOG_SETPOINT_ERROR, zone);
             }
 
-            send_value('S', g_thermostat_internals.setpoint);
+            send_zone_value(zone, 'S', g_zones.setpoint[zone]);
 
-            thermostat_process(&g_thermostat_internals);
+            thermostat_process(zone);
         }
         else if(0==strncmp(buff, "d=",2))
         {
-            if(temperature_parse(buff+2, &g_thermostat_internals.hysteresis))
+            if(temperature_parse(buff+2, &g_zones.hysteresis[zone]))
+            {
+                DLOG2(dlog_info, DLOG_HYSTERESIS, g_zones.hysteresis[zone], zone);
+            }
+            else
+            {
+                DLOG1(dlog_warn, DLOG_HYSTERESIS_ERROR, zone);
+            }
+
+            send_zone_value(zone, 'D', g_zones.hysteresis[zone]);
+
+            thermostat_process(zone);
+        }
+        else if(0==strncmp(buff, "g=",2))
+        {
+            if(temperature_parse(buff+2, &g_zones.dew_point_limit[zone]))
             {
-                printf("New hysteresis is set at %d celsius degrees\n", g_thermostat_internals.hysteresis);
+                DLOG2(dlog_info, DLOG_DEW_POINT_LIMIT, g_zones.dew_point_limit[zone], zone);
             }
             else
             {
-                printf("ERROR trying to update the hysteresis [%s]\n", buff); 
+                DLOG1(dlog_warn, DLOG_DEW_POINT_LIMIT_ERROR, zone);
             }
 
-            send_value('D', g_thermostat_internals.hysteresis);
+            send_zone_value(zone, 'G', g_zones.dew_point_limit[zone]);
 
-            thermostat_process(&g_thermostat_internals);
+            thermostat_process(zone);
+        }
+        else if(0==strncmp(buff, "b=",2))
+        {
+            int16_t value;
+
+            if(value_parse(buff+2, strlen(buff+2), &value) && value>=0 && value<g_sensors.count)
+            {
+                g_zones.sensor[zone] = (uint8_t)value;
+                DLOG2(dlog_info, DLOG_BINDING, zone, value);
+            }
+            else
+            {
+                DLOG1(dlog_warn, DLOG_BINDING_ERROR, zone);
+            }
+
+            send_zone_value(zone, 'B', g_zones.sensor[zone]);
+
+            thermostat_process(zone);
         }
         else if(0==strcmp(buff, "m=auto"))
         { 
-            g_thermostat_internals.mode = tm_auto;
+            g_zones.mode[zone] = tm_auto;
 
-            thermostat_process(&g_thermostat_internals);
-            send_mode();
+            thermostat_process(zone);
+            send_mode(zone);
         }
         else if(0==strcmp(buff, "m=heat"))
         { 
-            g_thermostat_internals.mode = tm_heat;
+            g_zones.mode[zone] = tm_heat;
+
+            thermostat_process(zone);
+            send_mode(zone);
+        }
+        else if(0==strcmp(buff, "m=cool"))
+        { 
+            g_zones.mode[zone] = tm_cool;
 
-            thermostat_process(&g_thermostat_internals);
-            send_mode();
+            thermostat_process(zone);
+            send_mode(zone);
         }
         else if(0==strcmp(buff, "m=off"))
         { 
-            g_thermostat_internals.mode = tm_off;
+            g_zones.mode[zone] = tm_off;
 
-            thermostat_process(&g_thermostat_internals);
-            send_mode();
+            thermostat_process(zone);
+            send_mode(zone);
         }
-        else if(cmd_process(buff, 'o', g_thermostat_internals.output ? 1 : 0) )
+        else if(cmd_process(zone, buff, 'o', g_zones.output[zone]) )
         {
         }
-        else if(cmd_process(buff, 't', g_thermostat_internals.temperature) )
+        else if(cmd_process(zone, buff, 't', g_sensors.temperature[sensor]) )
         {
         }
-        else if(cmd_process(buff, 'h', g_thermostat_internals.humidity) )
+        else if(cmd_process(zone, buff, 'h', g_sensors.humidity[sensor]) )
         {
         }
-        else if(cmd_process(buff, 's', g_thermostat_internals.setpoint) )
+        else if(cmd_process(zone, buff, 's', g_zones.setpoint[zone]) )
         {
         }
-        else if(cmd_process(buff, 'd', g_thermostat_internals.hysteresis) )
+        else if(cmd_process(zone, buff, 'd', g_zones.hysteresis[zone]) )
+        {
+        }
+        else if(cmd_process(zone, buff, 'p', g_sensors.dew_point[sensor]) )
+        {
+        }
+        else if(cmd_process(zone, buff, 'i', g_sensors.heat_index[sensor]) )
+        {
+        }
+        else if(cmd_process(zone, buff, 'g', g_zones.dew_point_limit[zone]) )
+        {
+        }
+        else if(cmd_process(zone, buff, 'b', g_zones.sensor[zone]) )
         {
         }
         else if(0==strcmp(buff, "m"))
         {
-            send_mode(); 
+            send_mode(zone); 
+        }
+        else if(0==strncmp(buff, "l=",2) && buff[2]>='0' && buff[2]<='0'+dlog_debug && !buff[3])
+        {
+            dlog_set_level((dlog_level_t)(buff[2]-'0'));
+            DLOG1(dlog_info, DLOG_LEVEL, dlog_get_level());
+            send_zone_value(zone, 'L', dlog_get_level());
+        }
+        else if(cmd_process(zone, buff, 'l', dlog_get_level()) )
+        {
+        }
+    }
+}
+
+/**
+ *  The local sensor is read by the main task and the remote ones arrive on
+ *  the MQTT task, so the four values change under the lock: a tick never sees
+ *  a new temperature with the old dew point.
+ */
+void sensor_update(uint8_t sensor, int16_t temperature, uint16_t humidity)
+{
+    int16_t dew_point = derived_dew_point(temperature, humidity);
+    int16_t heat_index = derived_heat_index(temperature, humidity);
+
+    portENTER_CRITICAL(&g_thermostat_mux);
+    g_sensors.temperature[sensor] = temperature;
+    g_sensors.humidity[sensor] = humidity;
+    g_sensors.dew_point[sensor] = dew_point;
+    g_sensors.heat_index[sensor] = heat_index;
+    portEXIT_CRITICAL(&g_thermostat_mux);
+}
+
+/**
+ *  Remote sensors, t=<tenths of celsius degrees> or h=<tenths of %>.
+ */
+void sensor_on_data(uint8_t sensor, const char* buff)
+{
+    int16_t value;
+
+    if(strlen(buff)>2 && '='==buff[1] && value_parse(buff+2, strlen(buff+2), &value))
+    {
+        if('t'==buff[0])
+        {
+            sensor_update(sensor, value, g_sensors.humidity[sensor]);
         }
+        else if('h'==buff[0] && value>=0)
+        {
+            sensor_update(sensor, g_sensors.temperature[sensor], (uint16_t)value);
+        }
+        else
+        {
+            return;
+        }
+
+        DLOG3(dlog_debug, DLOG_SENSOR, sensor, g_sensors.humidity[sensor], g_sensors.temperature[sensor]);
+        thermostat_process(-1);
+    }
+}
+
+void comm_on_data(const char* topic, const char* buff)
+{ 
+    uint16_t index;
+
+    if(!topic || !buff)
+        return;
+
+    if(0==strcmp(topic, CONFIG_MQTT_TOPIC_DEFAULT))
+    {
+        zone_on_data(0, buff);
+    }
+    else if(topic_index(topic, TOPIC_ZONE, g_zones.count, &index))
+    {
+        zone_on_data(index, buff);
+    }
+    else if(topic_index(topic, TOPIC_SENSOR, g_sensors.count, &index) && index>0)
+    {   // Sensor 0 is the on-board DHT22
+        sensor_on_data((uint8_t)index, buff);
+    }
+}
+
+/**
+ *  CONFIG_THERMOSTAT_ZONE_PINS, comma separated relay gpios, one per zone.
+ *  The whole list is rejected, returning 0, at the first entry that is not
+ *  a gpio able to drive a relay (34..39 are inputs only) or past ZONES_MAX.
+ */
+uint16_t pins_parse(const char* s, uint8_t* pins)
+{
+    uint16_t n = 0;
+
+    while(*s)
+    {
+        char* end;
+        long  pin = strtol(s, &end, 10);
+        int   len = (int)strcspn(s, ",");
+
+        if(n==ZONES_MAX)
+        {
+            printf("ERROR more than %u zone pins, at [%.*s]!\n", ZONES_MAX, len, s);
+            return 0;
+        }
+
+        if(end==s || (*end && ','!=*end))
+        {
+            printf("ERROR zone pin %u [%.*s] is not a number!\n", n, len, s);
+            return 0;
+        }
+
+        if(pin<0 || pin>=GPIO_NUM_MAX || !GPIO_IS_VALID_OUTPUT_GPIO(pin))
+        {
+            printf("ERROR zone pin %u [%.*s] is not an output gpio!\n", n, len, s);
+            return 0;
+        }
+
+        pins[n++] = (uint8_t)pin;
+        s = *end ? end+1 : end;
     }
+    return n;
+}
+
+
+/**
+ *  Record time in ms. dlog_write also runs from the DHT22 isr, where only the
+ *  FromISR flavour of the tick count may be called.
+ */
+uint32_t log_clock(void)
+{
+    TickType_t ticks = xPortInIsrContext() ? xTaskGetTickCountFromISR() : xTaskGetTickCount();
+
+    return ticks * portTICK_PERIOD_MS;
+}
+
+void log_print(const dlog_record_t* record)
+{
+    char s[LOG_LINE_SZ];
+
+    dlog_format(s, sizeof(s), record);
+    printf("%u %s %s\n", record->time, dlog_level_name(record->level), s);
 }
 
+/**
+ *  Drains the deferred log. With CONFIG_DLOG_PUBLISH the records go, still
+ *  binary, to <default topic>/log for host/dlog_dump to format, otherwise, or
+ *  while offline, they are formatted here and printed.
+ *
+ *  Each new low of the stack high water mark is logged, so LOG_TASK_STACK_SZ
+ *  can be checked on a board under both configurations.
+ */
+void log_task(void* arg)
+{
+#if defined(ESP_PLATFORM)
+    UBaseType_t low = LOG_TASK_STACK_SZ;
+#endif
+
+    for(;;)
+    {
+        dlog_record_t record;
+#if defined(CONFIG_DLOG_PUBLISH)
+        uint8_t       s[LOG_FRAME_SZ];
+        size_t        n = 0;
+
+        while(n+DLOG_RECORD_SZ_MAX<=sizeof(s) && dlog_read(&record))
+        {
+            n += dlog_serialize(&record, s+n);
+        }
+
+        if(n && !comm_send(CONFIG_MQTT_TOPIC_DEFAULT "/log", (const char*)s, n))
+        {
+            size_t k, sz;
+
+            for(k=0; k<n && (sz = dlog_deserialize(s+k, n-k, &record)); k+=sz)
+            {
+                log_print(&record);
+            }
+        }
+#else
+        while(dlog_read(&record))
+        {
+            log_print(&record);
+        }
+#endif
+#if defined(ESP_PLATFORM)
+        {
+            UBaseType_t mark = uxTaskGetStackHighWaterMark(NULL);
+
+            if(mark<low)
+            {
+                low = mark;
+                DLOG2(dlog_info, DLOG_LOG_STACK, mark, LOG_TASK_STACK_SZ);
+            }
+        }
+#endif
+        vTaskDelay( LOG_TASK_PERIOD_MS / portTICK_PERIOD_MS );
+    }
+}
 
 void app_main()
 {
-    int i;
+    uint8_t       pins[ZONES_MAX];
+    uint16_t      zones = pins_parse(CONFIG_THERMOSTAT_ZONE_PINS, pins);
+    gpio_config_t config = { 0, GPIO_MODE_OUTPUT|GPIO_MODE_INPUT, GPIO_PULLUP_DISABLE, GPIO_PULLDOWN_DISABLE, GPIO_INTR_DISABLE };
+    uint16_t      z;
+    int           i;
 
     ESP_LOGI(MQTT_TAG, "[APP] Startup..");
-    ESP_LOGI(MQTT_TAG, "[APP] Free memory: %d bytes", system_get_free_heap_size());
+    ESP_LOGI(MQTT_TAG, "[APP] Free memory: %u bytes", system_get_free_heap_size());
     ESP_LOGI(MQTT_TAG, "[APP] SDK version: %s, Build time: %s", system_get_sdk_version(), BUID_TIME);
 
+    if(!zones)
+    {
+        printf("ERROR invalid zone pins [%s], using %u!\n", CONFIG_THERMOSTAT_ZONE_PINS, PIN_OUTPUT);
+        pins[0] = PIN_OUTPUT;
+        zones = 1;
+    }
+
+    zones_init(&g_zones, pins, zones);
+    zones_sensors_init(&g_sensors, 1 + CONFIG_THERMOSTAT_REMOTE_SENSORS);
 
-    for(i=0; g_gpio_config[i].pin_bit_mask; ++i)
+    for(z=0; z<g_zones.count; ++z)
     {
-        if(ESP_OK!=gpio_config(&g_gpio_config[i]))
-        {
-            printf("ERROR during gpio_config for 0x%016llX mask!\n", g_gpio_config[i].pin_bit_mask);
-        }
+        config.pin_bit_mask |= 1ULL<<g_zones.pin[z];
+    }
+
+    if(ESP_OK!=gpio_config(&config))
+    {
+        printf("ERROR during gpio_config for 0x%016" PRIX64 " mask!\n", config.pin_bit_mask);
+    }
+
+    dlog_init(log_clock);
+    xTaskCreate(log_task, "log", LOG_TASK_STACK_SZ, NULL, tskIDLE_PRIORITY+1, NULL);
+    DLOG2(dlog_info, DLOG_ZONES, g_zones.count, g_sensors.count);
+
+    for(z=0; z<g_zones.count; ++z)
+    {   // All relays start off
+        drive(z);
     }
 
     comm_init(comm_on_data);
@@ -248,65 +825,106 @@ void app_main()
 
     for(i=0; ; ++i)
     {   
-        uint16_t  humidity;
-        int16_t   temperature;
-        bool      humidity_reported = false;
-        bool      temperature_reported = false;
+        uint16_t        humidity = g_sensors.humidity[0];
+        int16_t         temperature = g_sensors.temperature[0];
+        dht22_timing_t  timing;
+        bool            humidity_reported = false;
+        bool            temperature_reported = false;
+        bool            temperature_changed;
+        bool            humidity_changed;
 
         if(dht22_read(&humidity, &temperature))
         {
-            printf("DHT22 read successfully!\n");
-            printf("  humidity = %i.%u%%\n", humidity/10, humidity%10); 
-            printf("  temperature = %i.%u degrees\n", temperature/10, temperature%10); 
+            DLOG2(dlog_info, DLOG_DHT22_READ, humidity, temperature);
+
+            stats_sample(&g_stats_window, temperature, humidity);
         } 
 
-        if(temperature!=g_thermostat_internals.temperature)
-        {
-            g_thermostat_internals.temperature = temperature;
-            thermostat_process(&g_thermostat_internals);
+        temperature_changed = (temperature!=g_sensors.temperature[0]);
+        humidity_changed = (humidity!=g_sensors.humidity[0]);
+        sensor_update(0, temperature, humidity);
+
+        // Every cycle, remote sensors may have moved any zone in between
+        thermostat_process(-1);
 
-            send_value('T', g_thermostat_internals.temperature);
+        if(temperature_changed && RAW_TELEMETRY)
+        {
+            send_value('T', g_sensors.temperature[0]);
             temperature_reported = true;
         }
 
-        if(g_thermostat_internals.humidity!=humidity)
+        if(humidity_changed && RAW_TELEMETRY)
         {
-            g_thermostat_internals.humidity = humidity;
-            send_value('H', g_thermostat_internals.humidity);
+            send_value('H', g_sensors.humidity[0]);
             humidity_reported = true;
         } 
-        
-        if((i%12)==0 && !temperature_reported)
+
+        if(stats_tick(&g_stats_window, g_zones.output[0])>=CONFIG_THERMOSTAT_STATS_WINDOW)
         {
-            send_value('T', g_thermostat_internals.temperature);
+            send_stats(&g_stats_window);
+            stats_reset(&g_stats_window);
         }
 
-        if((i%12)==1 && !humidity_reported)
+        if((i%12)==0 && RAW_TELEMETRY && !temperature_reported)
         {
-            send_value('H', g_thermostat_internals.humidity);
+            send_value('T', g_sensors.temperature[0]);
         }
 
-        if((i%12)==2)
+        if((i%12)==1 && RAW_TELEMETRY && !humidity_reported)
         {
-            send_value('S', g_thermostat_internals.setpoint);
+            send_value('H', g_sensors.humidity[0]);
+        }
+
+        for(z=0; z<g_zones.count; ++z)
+        {
+            if((i%12)==2)
+            {
+                send_zone_value(z, 'S', g_zones.setpoint[z]);
+            }
+
+            if((i%12)==3)
+            {
+                send_zone_value(z, 'D', g_zones.hysteresis[z]);
+            }
+
+            if((i%12)==4)
+            {
+                send_zone_value(z, 'O', g_zones.output[z]); 
+            }
+
+            if((i%12)==5)
+            { 
+                send_mode(z);
+            }
+
+            if((i%12)==8)
+            {
+                send_zone_value(z, 'G', g_zones.dew_point_limit[z]);
+            }
+
+            if((i%12)==10)
+            {
+                send_zone_value(z, 'B', g_zones.sensor[z]);
+            }
         }
 
-        if((i%12)==3)
+        if((i%12)==6)
         {
-            send_value('D', g_thermostat_internals.hysteresis);
+            send_value('P', g_sensors.dew_point[0]);
         }
 
-        if((i%12)==4)
+        if((i%12)==7)
         {
-            send_value('O', g_thermostat_internals.output ? 1 : 0); 
+            send_value('I', g_sensors.heat_index[0]);
         }
 
-        if((i%12)==5)
-        { 
-            send_mode();
+        if((i%12)==9 && dht22_read_timing(&timing))
+        {   // Worst bit distance to the decoder threshold, in tenths of us
+            send_value('Q', timing.margin*10/DHT22_TICKS_PER_US);
         }
 
+        send_capture();
+
         vTaskDelay( 5000 / portTICK_PERIOD_MS );
     } 
 }
-
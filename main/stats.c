@@ -0,0 +1,124 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      stats.c
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "stats.h"
+#include "fmt.h"
+
+void stats_reset(stats_window_t* w)
+{
+    memset(w, 0, sizeof(*w));
+}
+
+void stats_sample(stats_window_t* w, int16_t temperature, uint16_t humidity)
+{
+    if(0==w->samples)
+    {
+        w->temperature_min = w->temperature_max = temperature;
+        w->humidity_min = w->humidity_max = humidity;
+    }
+    else
+    {
+        if(temperature<w->temperature_min) w->temperature_min = temperature;
+        if(temperature>w->temperature_max) w->temperature_max = temperature;
+        if(humidity<w->humidity_min) w->humidity_min = humidity;
+        if(humidity>w->humidity_max) w->humidity_max = humidity;
+    }
+
+    w->temperature_sum += temperature;
+    w->humidity_sum += humidity;
+    ++w->samples;
+}
+
+/**
+ *  Accounts one control loop iteration, returns the cycles in the window so far.
+ */
+uint16_t stats_tick(stats_window_t* w, bool output)
+{
+    if(output)
+        ++w->on_cycles;
+
+    return ++w->cycles;
+}
+
+/**
+ *  Means are rounded to the nearest tenth, halves away from zero.
+ */
+int16_t stats_temperature_mean(const stats_window_t* w)
+{
+    int32_t n = w->samples;
+
+    if(!n)
+        return 0;
+
+    return (int16_t)((w->temperature_sum<0 ? w->temperature_sum - n/2 : w->temperature_sum + n/2) / n);
+}
+
+uint16_t stats_humidity_mean(const stats_window_t* w)
+{
+    uint32_t n = w->samples;
+
+    if(!n)
+        return 0;
+
+    return (uint16_t)((w->humidity_sum + n/2) / n);
+}
+
+/**
+ *  Share of the window the output was on, in tenths of %.
+ */
+uint16_t stats_duty(const stats_window_t* w)
+{
+    uint32_t n = w->cycles;
+
+    if(!n)
+        return 0;
+
+    return (uint16_t)((1000u*w->on_cycles + n/2) / n);
+}
+
+/**
+ *  W=<samples>,<t min>,<t mean>,<t max>,<h min>,<h mean>,<h max>,<duty>
+ *
+ *  Temperature and humidity are in tenths like the raw T= and H= frames and
+ *  duty is in tenths of %. With no valid samples only W=0,,,,,,,<duty> is sent.
+ */
+size_t stats_format(char* buff, const stats_window_t* w)
+{
+    size_t n = 2;
+
+    buff[0] = 'W';
+    buff[1] = '=';
+    n += fmt_uint(buff+n, w->samples);
+    buff[n++] = ',';
+    if(w->samples)
+    {
+        n += fmt_int(buff+n, w->temperature_min);
+        buff[n++] = ',';
+        n += fmt_int(buff+n, stats_temperature_mean(w));
+        buff[n++] = ',';
+        n += fmt_int(buff+n, w->temperature_max);
+        buff[n++] = ',';
+        n += fmt_uint(buff+n, w->humidity_min);
+        buff[n++] = ',';
+        n += fmt_uint(buff+n, stats_humidity_mean(w));
+        buff[n++] = ',';
+        n += fmt_uint(buff+n, w->humidity_max);
+        buff[n++] = ',';
+    }
+    else
+    {
+        n += fmt_str(buff+n, ",,,,,,");
+    }
+    n += fmt_uint(buff+n, stats_duty(w));
+
+    return n;
+}
@@ -0,0 +1,52 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      stats.h
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ */
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "fmt.h"
+
+/**
+ *  Running min/max/sum over one reporting window. Samples are folded in as
+ *  they arrive, so the cost per sample is constant and nothing is buffered.
+ *
+ *  cycles counts the control loop iterations in the window and on_cycles the
+ *  ones that ended with the output on; samples only counts valid readings.
+ */
+typedef struct
+{
+    uint16_t    cycles;
+    uint16_t    on_cycles;
+    uint16_t    samples;
+
+    int16_t     temperature_min;    // in tenths of celsius degrees
+    int16_t     temperature_max;
+    int32_t     temperature_sum;
+
+    uint16_t    humidity_min;       // in tenths of %
+    uint16_t    humidity_max;
+    uint32_t    humidity_sum;
+} stats_window_t;
+
+// "W=" + 8 comma separated integers + '\0'
+#define STATS_FRAME_SZ  (2 + 8*(FMT_INT_LEN_MAX+1) + 1)
+
+void     stats_reset(stats_window_t* w);
+void     stats_sample(stats_window_t* w, int16_t temperature, uint16_t humidity);
+uint16_t stats_tick(stats_window_t* w, bool output);
+
+int16_t  stats_temperature_mean(const stats_window_t* w);
+uint16_t stats_humidity_mean(const stats_window_t* w);
+uint16_t stats_duty(const stats_window_t* w);
+
+size_t   stats_format(char* buff, const stats_window_t* w);
+
+#endif
@@ -0,0 +1,92 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      zones.c
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "zones.h"
+
+/**
+ *  Every zone starts as the single zone thermostat did: auto at 25.0 with a
+ *  0.5 hysteresis, output off, no dew point guard, following sensor 0.
+ */
+void zones_init(zone_table_t* zones, const uint8_t* pins, uint16_t count)
+{
+    uint16_t z;
+
+    if(count>ZONES_MAX)
+        count = ZONES_MAX;
+
+    memset(zones, 0, sizeof(*zones));
+    zones->count = count;
+
+    for(z=0; z<count; ++z)
+    {
+        zones->setpoint[z] = 250;
+        zones->hysteresis[z] = 5;
+        zones->dew_point_limit[z] = ZONES_GUARD_OFF;
+        zones->mode[z] = tm_auto;
+        zones->pin[z] = pins[z];
+    }
+}
+
+void zones_sensors_init(zone_sensors_t* sensors, uint8_t count)
+{
+    uint8_t k;
+
+    if(count>ZONES_SENSORS_MAX)
+        count = ZONES_SENSORS_MAX;
+
+    memset(sensors, 0, sizeof(*sensors));
+    sensors->count = count;
+
+    for(k=0; k<count; ++k)
+    {
+        sensors->temperature[k] = 250;
+    }
+}
+
+/**
+ *      T = off
+ *      ---------------- setpoint+hysteresis
+ *
+ *      ================ setpoint
+ *
+ *      ---------------- setpoint-hysteresis
+ *      T = on
+ *
+ *  Cool mode mirrors it, on over setpoint+hysteresis and off under
+ *  setpoint-hysteresis, and the dew point guard overrides it: the output
+ *  stays off while the dew point is at or over dew_point_limit, so the
+ *  radiant surfaces never run below the dew point. Heating is not gated.
+ *
+ *  One control tick over all the zones. The loop is branch free so it runs at
+ *  a steady cost per zone; the indexes of the zones whose output changed are
+ *  stored in changed[] (room for zones->count entries) and counted in the
+ *  return value, so only those relays need to be driven and reported.
+ */
+uint16_t zones_evaluate(zone_table_t* zones, const zone_sensors_t* sensors, uint16_t* changed)
+{
+    uint16_t z, n = 0;
+
+    for(z=0; z<zones->count; ++z)
+    {
+        uint8_t s = zones->sensor[z];
+        uint8_t output = zones->output[z];
+        int16_t band = output ? zones->hysteresis[z] : -zones->hysteresis[z];
+        uint8_t heat = sensors->temperature[s] < zones->setpoint[z] + band;
+        uint8_t cool = (sensors->temperature[s] > zones->setpoint[z] - band) & (sensors->dew_point[s]<zones->dew_point_limit[z]);
+        uint8_t mode = zones->mode[z];
+        uint8_t next = ((tm_auto==mode) & heat) | ((tm_cool==mode) & cool) | (tm_heat==mode);
+
+        zones->output[z] = next;
+        changed[n] = z;
+        n += next ^ output;
+    }
+    return n;
+}
@@ -0,0 +1,71 @@
+/**
+ *  @brief     Proof of concept of a simple thermostat using a ESP32 module and a DHT22 sensor.
+ *
+ *  @file      zones.h
+ *  @author    Hernan Bartoletti - hernan.bartoletti@gmail.com
+ *  @copyright MIT License
+ */
+#ifndef ZONES_H
+#define ZONES_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ *  Zone table: one entry per relay, each with its own setpoint, hysteresis,
+ *  mode, dew point limit and the sensor it follows. It is kept as a struct of
+ *  arrays walked by a branch free tick, so the tick costs the same whatever
+ *  the zones are doing and the time spent under the thermostat lock, with
+ *  interrupts off, is fixed by the zone count. It is not about speed: up to
+ *  a few hundred zones the former per zone logic is as fast (zones_bench).
+ *
+ *  Sensors are a separate table indexed by zone.sensor[]; several zones can
+ *  follow the same sensor without copying its readings into each zone.
+ */
+#if !defined(ZONES_MAX)
+#define ZONES_MAX           16
+#endif
+
+#if !defined(ZONES_SENSORS_MAX)
+#define ZONES_SENSORS_MAX   16
+#endif
+
+#define ZONES_GUARD_OFF     INT16_MAX   // dew point limit that never trips
+
+typedef enum
+{
+    tm_off
+,   tm_auto     // heating, on below the setpoint
+,   tm_heat     // forced on
+,   tm_cool     // radiant cooling, on above the setpoint, held off by the dew point guard
+} thermostat_mode_t;
+
+typedef struct
+{
+    uint16_t    count;
+
+    int16_t     setpoint[ZONES_MAX];        // in tenths of celsius degrees
+    int16_t     hysteresis[ZONES_MAX];      // in tenths of celsius degrees
+    int16_t     dew_point_limit[ZONES_MAX]; // in tenths, cool mode keeps the output off from here up
+    uint8_t     mode[ZONES_MAX];            // thermostat_mode_t
+    uint8_t     sensor[ZONES_MAX];          // index into zone_sensors_t
+    uint8_t     pin[ZONES_MAX];             // relay gpio
+    uint8_t     output[ZONES_MAX];          // 0 or 1
+} zone_table_t;
+
+typedef struct
+{
+    uint8_t     count;
+
+    int16_t     temperature[ZONES_SENSORS_MAX]; // in tenths of celsius degrees
+    uint16_t    humidity[ZONES_SENSORS_MAX];    // in tenths of %
+    int16_t     dew_point[ZONES_SENSORS_MAX];   // in tenths of celsius degrees
+    int16_t     heat_index[ZONES_SENSORS_MAX];  // in tenths of celsius degrees, just to report..
+} zone_sensors_t;
+
+void     zones_init(zone_table_t* zones, const uint8_t* pins, uint16_t count);
+void     zones_sensors_init(zone_sensors_t* sensors, uint8_t count);
+uint16_t zones_evaluate(zone_table_t* zones, const zone_sensors_t* sensors, uint16_t* changed);
+
+#endif